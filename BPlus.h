@@ -6,53 +6,145 @@
 #define ADS_BTREE_BTREE_H
 
 #include <iostream>
+#include <algorithm>
+#include <cstddef>
 #include <functional>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "ExternalSort.h"
+#include "Pool.h"
+#include "Stats.h"
+#include "TreeFile.h"
 using namespace std;
 
-template<typename T>
+template<typename T, typename Stats = NoStats, typename Alloc = allocator<T>>
 class BPlus {
     class Node {
         int n {}; // number of keys
         T** key {}; // array of keys
         Node** c {}; // array of pointers to children
+        Node* next {}; // right sibling, only used by leaves
         bool leaf {}; // boolean, true if it is a leaf
+        size_t pre {}; // length of the prefix shared by all keys (string keys only)
         friend BPlus;
+    };
+
+    // A node and its arrays of keys and children share a single block from
+    // the allocator, counted in max_align_t units so that any allocator
+    // (std::pmr included) returns it suitably aligned. Keys come from the
+    // same allocator one by one.
+    using Blocks = typename allocator_traits<Alloc>::template rebind_alloc<max_align_t>;
+    using Keys = typename allocator_traits<Alloc>::template rebind_alloc<T>;
+
+    size_t units() const {
+        size_t m = (t<<1); // order of tree
+        size_t bytes = sizeof(Node) + (m - 1) * sizeof(T*) + m * sizeof(Node*);
+        return (bytes + sizeof(max_align_t) - 1) / sizeof(max_align_t);
+    }
+
+    Node* new_node() {
+        int m = (t<<1); // order of tree
+        Node* x = new (node_alloc.allocate(units())) Node();
+        x->leaf = true;
+        x->key = (T**)(x + 1);
+        for (int i = 1; i < m; ++i)
+            x->key[i - 1] = nullptr;
+        x->c = (Node**)(x->key + m - 1);
+        for (int i = 0; i < m; ++i)
+            x->c[i] = nullptr;
+        return x;
+    }
+
+    // frees x and its keys, not its children
+    void delete_node(Node* x) {
+        for (int i = 0; i < x->n; ++i)
+            delete_key(x->key[i]);
+        x->~Node();
+        node_alloc.deallocate((max_align_t*)x, units());
+    }
+
+    T* new_key(const T& k) {
+        T* p = key_alloc.allocate(1);
+        allocator_traits<Keys>::construct(key_alloc, p, k);
+        return p;
+    }
 
-    public:
-        Node() : leaf(true) {}
-        explicit Node(int t) {
-            int m = (t<<1); // order of tree
-            n = 0;
-            leaf = true;
+    void delete_key(T* p) {
+        allocator_traits<Keys>::destroy(key_alloc, p);
+        key_alloc.deallocate(p, 1);
+    }
 
-            key = new T*[m - 1];
-            for (int i = 1; i < m; ++i)
-                key[i - 1] = nullptr;
+    static constexpr bool is_string = is_same<T, string>::value;
 
-            c = new Node*[m];
-            for (int i = 0; i < m; ++i)
-                c[i] = nullptr;
+    // Shortest separator s with a < s <= b, where a is the greatest key left
+    // of a split and b the smallest key right of it. For strings that is the
+    // prefix of b one character past their common prefix.
+    static T separator_value(const T& a, const T& b) {
+        if constexpr (is_string) {
+            size_t l = 0;
+            while (l < a.size() && l < b.size() && a[l] == b[l]) ++l;
+            return b.substr(0, l + 1);
+        }
+        else return b;
+    }
+    T* separator(const T& a, const T& b) { return new_key(separator_value(a, b)); }
+
+    // recomputes the prefix shared by x's keys, which is the common prefix
+    // of the first and the last one since keys are sorted
+    static void refresh(Node* x) {
+        if constexpr (is_string) {
+            x->pre = 0;
+            if (x->n == 0) return;
+            const string& a = *x->key[0];
+            const string& b = *x->key[x->n - 1];
+            while (x->pre < a.size() && x->pre < b.size() && a[x->pre] == b[x->pre]) ++x->pre;
         }
-        ~Node() {
-            for (int i = 0; i < (n<<1) - 1; ++i)
-                delete key[i];
-            delete[] key;
+    }
 
-            for (int i = 0; i < (n<<1); ++i)
-                delete c[i];
-            delete[] c;
+    // index of the first key >= k (> k if strict). String keys compare the
+    // node's shared prefix once and skip it on every key comparison.
+    int find(Node* x, const T& k, bool strict = false) {
+        int i = 0;
+        if constexpr (is_string) {
+            if (x->n == 0) return 0;
+            stats.compare(1);
+            int cmp = k.compare(0, x->pre, *x->key[0], 0, x->pre);
+            if (cmp < 0) return 0;
+            if (cmp > 0) return x->n;
+            for (; i < x->n; ++i) {
+                cmp = k.compare(x->pre, string::npos, *x->key[i], x->pre, string::npos);
+                if (cmp < 0 || (cmp == 0 && !strict)) break;
+            }
         }
-    };
+        else {
+            for (; i < x->n; ++i)
+                if (strict ? k < *x->key[i] : k <= *x->key[i]) break;
+        }
+        stats.compare(min(i + 1, x->n));
+        return i;
+    }
 
     void create_root(T k) {
-        root = new Node(t);
+        root = new_node();
+        stats.allocate();
+        stats.grow();
+        shape += 1;
         root->n = 1;
-        root->key[0] = new T(k);
+        root->key[0] = new_key(k);
+        refresh(root);
     }
 
     void split_root() {
-        Node* s = new Node(t);
+        Node* s = new_node();
         s->leaf = false;
+        stats.allocate();
+        stats.grow();
+        shape += 1;
 
         s->c[0] = root;
         root = s;
@@ -68,39 +160,57 @@ class BPlus {
         for (int j = x->n; j > i + 1; --j) // shift children right
             x->c[j] = x->c[j - 1];
 
-        int m = t - 1; // median of child's keys' array
         Node* y = x->c[i];
+        Node* z = new_node();
+        z->leaf = y->leaf;
+        stats.allocate();
+        stats.split();
+        shape += 1;
+
+        if (y->leaf) {
+            for (int j = 0; j < t; ++j) // assign to z, y's greatest keys
+                z->key[j] = y->key[j + t - 1];
+            z->n = t;
+            y->n = t - 1;
+
+            x->key[i] = separator(*y->key[t - 2], *z->key[0]); // copy a separator up
+            z->next = y->next;
+            y->next = z;
+        }
+        else {
+            int m = t - 1; // median of child's keys' array
+            for (int j = 0; j < m; ++j) // assign to z, y's greatest keys
+                z->key[j] = y->key[j + t];
 
-        Node* z = new Node(t);
-        for (int j = 0; j < m; ++j) // assign to z, y's greatest keys
-            z->key[j] = y->key[j + t];
-
-        for (int j = 0; j <= m; ++j) // assign to z, y's greatest children
-            z->c[j] = y->c[j + t];
+            for (int j = 0; j <= m; ++j) // assign to z, y's greatest children
+                z->c[j] = y->c[j + t];
 
-        x->key[i] = y->key[m]; // insert middle key in x
+            x->key[i] = y->key[m]; // move middle key to x
+            z->n = t - 1;
+            y->n = t - 1;
+        }
         x->c[i + 1] = z; // insert child in x
 
-        z->n = t - 1;
-        y->n = t - 1;
-
-        z->leaf = y->leaf;
+        refresh(x);
+        refresh(y);
+        refresh(z);
     }
 
     void insert_non_full(Node* x, T k) {
-        int i = 0;
-        for (; i < x->n; ++i)
-            if (k <= *x->key[i]) break;
-
-        if (i < x->n && *x->key[i] == k) return;
+        stats.visit();
         if (x->leaf) {
-            for (int j = i + 1; j <= x->n; ++j)
+            int i = find(x, k);
+            if (i < x->n && *x->key[i] == k) return;
+
+            for (int j = x->n; j > i; --j) // shift keys right
                 x->key[j] = x->key[j - 1];
-            x->key[i] = new T(k);
+            x->key[i] = new_key(k);
             x->n += 1;
+            refresh(x);
             return;
         }
 
+        int i = find(x, k, true);
         if (x->c[i]->n == (t<<1) - 1) {
             split_children(x, i);
             return insert_non_full(x, k);
@@ -108,219 +218,1030 @@ class BPlus {
         return insert_non_full(x->c[i], k);
     }
 
-    T* predecessor(Node* x) {
-        if (x->leaf) return x->key[x->n - 1];
-        return predecessor(x->c[x->n]);
+    // Lays out x's new content (keys, and children for internal nodes) over x
+    // and as many fresh siblings as needed, split evenly. Returns the
+    // siblings with the separators the parent has to add after x.
+    vector<pair<T*, Node*>> pack(Node* x, const vector<T*>& keys, const vector<Node*>& children) {
+        int cap = (x->leaf ? (t<<1) - 1 : (t<<1)); // keys per leaf, children per internal node
+        int total = (int)(x->leaf ? keys.size() : children.size());
+        int p = max(1, (total + cap - 1) / cap);
+
+        vector<pair<T*, Node*>> extra;
+        Node* next = x->next;
+        Node* y = x;
+        int k = 0, ch = 0;
+        for (int j = 0; j < p; ++j) {
+            int cnt = total / p + (j < total % p);
+            T* sep = nullptr;
+            if (j > 0) {
+                Node* z = new_node();
+                z->leaf = x->leaf;
+                stats.allocate();
+                stats.split();
+                shape += 1;
+                if (z->leaf) {
+                    sep = separator(*keys[k - 1], *keys[k]);
+                    y->next = z;
+                }
+                else sep = keys[k++]; // key between both pieces moves up
+                extra.push_back({sep, z});
+                y = z;
+            }
+
+            if (y->leaf) {
+                for (int i = 0; i < cnt; ++i)
+                    y->key[i] = keys[k++];
+                y->n = cnt;
+            }
+            else {
+                for (int i = 0; i < cnt; ++i)
+                    y->c[i] = children[ch++];
+                for (int i = cnt; i <= (t<<1) - 1; ++i)
+                    y->c[i] = nullptr;
+                for (int i = 0; i < cnt - 1; ++i)
+                    y->key[i] = keys[k++];
+                y->n = cnt - 1;
+            }
+            refresh(y);
+        }
+        if (y->leaf) y->next = next;
+        return extra;
+    }
+
+    // Merges the keys of the sorted run [first, last) that are smaller than
+    // hi (all of them if hi is null) into the subtree x, visiting each child
+    // once. Nodes that overflow are cut by pack.
+    template<typename It>
+    vector<pair<T*, Node*>> insert_batch(Node* x, It& first, It last, const T* hi) {
+        stats.visit();
+        vector<T*> keys;
+        vector<Node*> children;
+        if (x->leaf) {
+            int i = 0;
+            while (first != last && (hi == nullptr || *first < *hi)) {
+                T k = *first;
+                ++first;
+                while (i < x->n && *x->key[i] < k) keys.push_back(x->key[i++]);
+                if ((i < x->n && *x->key[i] == k) || (!keys.empty() && *keys.back() == k)) continue;
+                keys.push_back(new_key(k));
+            }
+            while (i < x->n) keys.push_back(x->key[i++]);
+        }
+        else {
+            for (int i = 0; i <= x->n; ++i) {
+                children.push_back(x->c[i]);
+                const T* bound = (i < x->n ? x->key[i] : hi);
+                if (first != last && (bound == nullptr || *first < *bound)) {
+                    for (auto& [sep, z] : insert_batch(x->c[i], first, last, bound)) {
+                        keys.push_back(sep);
+                        children.push_back(z);
+                    }
+                }
+                if (i < x->n) keys.push_back(x->key[i]);
+            }
+        }
+        return pack(x, keys, children);
     }
 
-    T* successor(Node* x) {
-        if (x->leaf) return x->key[0];
-        return successor(x->c[0]);
+    // number of threads worth using on n items
+    static int parts(size_t n, int threads) {
+        return (int)max<size_t>(1, min<size_t>(threads, n / 4096));
+    }
+
+    // runs f(j, lo, hi) on p threads, [lo, hi) being the j-th of p even
+    // slices of [0, n)
+    template<typename F>
+    static void parallel(int p, size_t n, F f) {
+        vector<thread> pool;
+        for (int j = 1; j < p; ++j)
+            pool.emplace_back(f, j, n * j / p, n * (j + 1) / p);
+        f(0, 0, n / p);
+        for (thread& th : pool) th.join();
+    }
+
+    // first index of the j-th of q even pieces of n items
+    static size_t piece(size_t j, size_t q, size_t n) { return j * (n / q) + min(j, n % q); }
+
+    // Bottom-up build from a stream of ascending distinct keys. spine[h] is
+    // the rightmost node of level h, the only one still open: it fills up
+    // completely before the next node of its level starts.
+    void append(vector<Node*>& spine, const T& k) {
+        Node* x = spine[0];
+        if (x->n == (t<<1) - 1) {
+            refresh(x);
+            Node* z = new_node();
+            stats.allocate();
+            x->next = z;
+            push_up(spine, 1, separator(*x->key[x->n - 1], k), z);
+            spine[0] = x = z;
+        }
+        x->key[x->n] = new_key(k);
+        x->n += 1;
+    }
+
+    // adds child z after the open node of level h - 1, sep between them
+    void push_up(vector<Node*>& spine, size_t h, T* sep, Node* z) {
+        if (h == spine.size()) { // the tree grows a root
+            Node* s = new_node();
+            s->leaf = false;
+            s->c[0] = spine[h - 1];
+            spine.push_back(s);
+            stats.allocate();
+            stats.grow();
+        }
+        Node* x = spine[h];
+        if (x->n == (t<<1) - 1) { // full, z starts the next node and sep moves up
+            refresh(x);
+            Node* s = new_node();
+            s->leaf = false;
+            s->c[0] = z;
+            stats.allocate();
+            push_up(spine, h + 1, sep, s);
+            spine[h] = s;
+            return;
+        }
+        x->key[x->n] = sep;
+        x->c[x->n + 1] = z;
+        x->n += 1;
+    }
+
+    // the open nodes may hold too few keys, they borrow from their left
+    // sibling, which is full. Top-down, since an open node may have no left
+    // sibling under its parent until the parent itself has borrowed.
+    void finish(vector<Node*>& spine) {
+        for (Node* x : spine) refresh(x);
+        for (size_t h = spine.size() - 1; h-- > 0;) {
+            Node* x = spine[h + 1];
+            while (spine[h]->n < t - 1)
+                erase_3a(x, x->n, x->c[x->n - 1]);
+        }
+        root = spine.back();
+        if (root->n == 0) {
+            delete_node(root);
+            root = nullptr;
+        }
     }
 
     void erase_1(Node* x, int i) {
+        delete_key(x->key[i]);
         for (int j = i + 1; j < x->n; ++j) // shift keys left
             x->key[j - 1] = x->key[j];
 
         x->n -= 1; // decrease key count
+        refresh(x);
     }
 
-    void erase_2a(Node* x, int i) {
-        x->key[i] = predecessor(x->c[i]);
-        erase(x->c[i], *x->key[i]);
-    }
+    // x->c[i] has t - 1 keys, borrow one from sibling z
+    void erase_3a(Node* x, int i, Node* z) {
+        stats.borrow();
+        shape += 1;
+        Node* y = x->c[i];
+        if (i > 0 && z == x->c[i - 1]) { // left sibling
+            for (int j = y->n; j > 0; --j) // shift all keys right
+                y->key[j] = y->key[j - 1];
+            if (!y->leaf)
+                for (int j = y->n + 1; j > 0; --j) // shift all children right
+                    y->c[j] = y->c[j - 1];
+            y->n += 1; // update y's key count
+            z->n -= 1;
+
+            if (y->leaf) {
+                y->key[0] = z->key[z->n];
+                delete_key(x->key[i - 1]);
+                x->key[i - 1] = separator(*z->key[z->n - 1], *y->key[0]);
+            }
+            else {
+                y->key[0] = x->key[i - 1]; // add key to y
+                y->c[0] = z->c[z->n + 1]; // add child to y
+                x->key[i - 1] = z->key[z->n];
+                z->c[z->n + 1] = nullptr;
+            }
+        }
+        else { // right sibling
+            if (y->leaf) {
+                y->key[y->n] = z->key[0];
+                y->n += 1;
+            }
+            else {
+                y->key[y->n] = x->key[i]; // add key to y
+                y->n += 1;
+                y->c[y->n] = z->c[0]; // add child to y
+                x->key[i] = z->key[0];
+            }
 
-    void erase_2b(Node* x, int i) {
-        x->key[i] = successor(x->c[i + 1]);
-        erase(x->c[i + 1], *x->key[i]);
+            for (int j = 1; j < z->n; ++j)
+                z->key[j - 1] = z->key[j];
+            if (!z->leaf)
+                for (int j = 1; j <= z->n; ++j)
+                    z->c[j - 1] = z->c[j];
+            z->c[z->n] = nullptr;
+            z->n -= 1;
+
+            if (y->leaf) {
+                delete_key(x->key[i]);
+                x->key[i] = separator(*y->key[y->n - 1], *z->key[0]);
+            }
+        }
+        refresh(x);
+        refresh(y);
+        refresh(z);
     }
 
-    void erase_2c(Node* x, int i) {
+    // merges x->c[i + 1] into x->c[i]
+    void erase_3b(Node* x, int i) {
+        stats.merge();
+        shape += 1;
         Node* y = x->c[i];
         Node* z = x->c[i + 1];
 
-        y->n = (t<<1) - 1;
-        y->key[t - 1] = x->key[i];
-        for (int j = 0; j < t - 1; ++j) // merge keys in y
-            y->key[j + t] = z->key[j];
-        for (int j = 0; j < t; ++j) // merge children in y
-            y->c[j + t] = z->c[j];
+        if (y->leaf) {
+            delete_key(x->key[i]); // separator is no longer needed
+            y->next = z->next;
+        }
+        else {
+            y->key[y->n] = x->key[i]; // add median key to y
+            y->n += 1;
+        }
 
-        for (int j = i + 1; j < x->n; ++j) // shift left keys in x
-            x->key[j - 1] = x->key[j];
-        for (int j = i + 1; j < x->n; ++j) // shift left children in x
-            x->c[j] = x->c[j + 1];
+        for (int j = 0; j < z->n; ++j) // receive keys from right child
+            y->key[j + y->n] = z->key[j];
+        if (!y->leaf)
+            for (int j = 0; j <= z->n; ++j) // receive children from right child
+                y->c[j + y->n] = z->c[j];
+        y->n += z->n;
 
+        for (int j = i + 1; j < x->n; ++j) // shift x's keys left
+            x->key[j - 1] = x->key[j];
+        for (int j = i + 2; j <= x->n; ++j) // shift x's children left
+            x->c[j - 1] = x->c[j];
         x->c[x->n] = nullptr;
-        x->n -= 1; // reduce x's key count
+        x->n -= 1;
 
         z->n = 0;
-        delete z;
+        delete_node(z);
 
-        erase(x->c[i], *y->key[t - 1]);
+        refresh(x);
+        refresh(y);
     }
 
-    void erase_2(Node* x, int i) {
-        if (i > 0 && x->c[i - 1]->n >= t) return erase_2a(x, i);
-        else if (i < (t<<1) - 2 && x->c[i + 1]->n >= t) return erase_2b(x, i);
-        else erase_2c(x, i);
+    // makes sure x->c[i] has at least t keys before descending into it
+    void erase_3(Node* x, int i) {
+        if (i > 0 && x->c[i - 1]->n >= t) return erase_3a(x, i, x->c[i - 1]);
+        if (i < x->n && x->c[i + 1]->n >= t) return erase_3a(x, i, x->c[i + 1]);
+        return erase_3b(x, (i < x->n ? i : i - 1));
     }
 
-    void erase_3a(Node* x, int i, T k) {
-        Node* y = x->c[i];
-        if (i > 0 && x->c[i - 1]->n >= t) {
-            for (int j = 0; j < y->n; ++j) // shift all keys right
-                y->key[j + 1] = y->key[j];
-            for (int j = 0; j <= y->n; ++j) // shift all children right
-                y->c[i + 1] = y->c[i];
-            y->n += 1; // update y's key count
+    void erase(Node* x, T k) {
+        stats.visit();
+        if (x->leaf) {
+            int i = find(x, k);
+            if (i < x->n && *x->key[i] == k) erase_1(x, i);
+            return;
+        }
 
-            Node* z = x->c[i - 1]; // left child (from whom a key & child are borrowed)
-            y->key[0] = x->key[i - 1]; // add key to y
-            y->c[0] = z->c[z->n]; // add child to y
+        int i = find(x, k, true);
+        if (x->c[i]->n >= t) return erase(x->c[i], k);
+        erase_3(x, i);
+        return erase(x, k);
+    }
 
-            z->n -= 1;
-            x->key[i - 1] = z->key[z->n];
-            z->c[z->n] = nullptr;
+    bool search(Node* x, T k) {
+        stats.visit();
+        if (!x->leaf) return search(x->c[find(x, k, true)], k);
+
+        int i = find(x, k);
+        return i < x->n && *x->key[i] == k;
+    }
 
-            erase(x->c[i], k);
+    void traverse(Node* x, function<void(T)> process) {
+        while (!x->leaf) x = x->c[0];
+        for (; x != nullptr; x = x->next) {
+            stats.visit();
+            for (int i = 0; i < x->n; ++i)
+                process(*x->key[i]);
         }
-        else {
-            Node* z = x->c[i + 1]; // right child (from whom a key & child are borrowed)
+    }
 
-            y->key[y->n] = x->key[i]; // add key to y
-            y->n += 1;
-            y->c[y->n] = z->c[0]; // add child to y
+    void clear(Node* x) {
+        if (!x->leaf)
+            for (int i = 0; i <= x->n; ++i)
+                clear(x->c[i]);
+        delete_node(x);
+    }
 
-            x->key[i] = z->key[0];
-            for (int j = 1; j < z->n; ++j)
-                z->key[j - 1] = z->key[j];
-            for (int j = 1; j <= z->n; ++j)
-                z->c[j - 1] = z->c[j];
+    // levels below x
+    static int height(Node* x) {
+        int h = 0;
+        for (; !x->leaf; x = x->c[0]) ++h;
+        return h;
+    }
 
-            z->c[z->n] = nullptr;
-            z->n -= 1;
+    // frees x but not its keys, which have moved elsewhere
+    void drop_node(Node* x) {
+        x->n = 0;
+        delete_node(x);
+    }
 
-            erase(x->c[i], k);
+    // x as the root of a tree of its own: null if it is an empty leaf, its
+    // only child if it has no keys left
+    Node* settle(Node* x) {
+        if (x->n > 0) {
+            refresh(x);
+            return x;
         }
+        Node* c = (x->leaf ? nullptr : x->c[0]);
+        delete_node(x);
+        return c;
     }
 
-    void erase_3b(Node* x, int i, T k) {
-        if (i > 0) {
-            Node* y = x->c[i - 1];
-            y->key[y->n] = x->key[i - 1]; // add median key to left child
-            y->n += 1;
-
-            Node* z = x->c[i];
-            for (int j = 0; j < z->n; ++j) // pass keys to left child
-                y->key[j + y->n] = z->key[j];
-            y->n += 1;
-            for (int j = 0; j <= z->n; ++j) // pass children to left child
-                y->c[j + y->n] = z->c[j];
-            y->n = (t<<1) - 1;
+    // merges x->c[i] and x->c[i + 1] if they fit in one node, otherwise
+    // moves keys across until both have at least t - 1
+    void balance(Node* x, int i) {
+        Node* y = x->c[i];
+        Node* z = x->c[i + 1];
+        if (y->n + z->n + !y->leaf <= (t<<1) - 1) return erase_3b(x, i);
+        while (y->n < t - 1) erase_3a(x, i, z);
+        while (z->n < t - 1) erase_3a(x, i + 1, y);
+    }
 
-            for (int j = i; j < x->n; ++j) // shift x's keys left
-                x->key[j - 1] = x->key[j];
-            for (int j = i + 1; j <= x->n; ++j) // shift x's children left
-                x->c[j - 1] = x->c[j];
-            x->n -= 1;
+    // Joins trees a and b, every key of a being smaller than s and every key
+    // of b at least s, either of them possibly empty and their roots possibly
+    // down to one key. The shorter tree becomes the outermost child of the
+    // taller one's node on its level, full nodes on the way being split.
+    Node* join(Node* a, T* s, Node* b) {
+        if (a == nullptr || b == nullptr) {
+            delete_key(s);
+            return (a != nullptr ? a : b);
+        }
+        int ha = height(a), hb = height(b);
+        if (ha == hb) {
+            Node* r = new_node();
+            r->leaf = false;
+            stats.allocate();
+            r->key[0] = s;
+            r->c[0] = a;
+            r->c[1] = b;
+            r->n = 1;
+            refresh(r);
+            balance(r, 0);
+            return settle(r);
+        }
 
-            z->n = 0;
-            delete z;
+        Node* top = (ha > hb ? a : b);
+        int h = max(ha, hb);
+        if (top->n == (t<<1) - 1) { // no room below, grow first
+            Node* r = new_node();
+            r->leaf = false;
+            stats.allocate();
+            r->c[0] = top;
+            split_children(r, 0);
+            top = r;
+            h += 1;
+        }
+        Node* x = top;
+        for (; h > min(ha, hb) + 1; --h) {
+            int i = (ha > hb ? x->n : 0);
+            if (x->c[i]->n == (t<<1) - 1) {
+                split_children(x, i);
+                i = (ha > hb ? x->n : 0);
+            }
+            x = x->c[i];
+        }
 
-            erase(x->c[i - 1], k);
+        if (ha > hb) {
+            x->key[x->n] = s;
+            x->c[x->n + 1] = b;
+            x->n += 1;
+            refresh(x);
+            balance(x, x->n - 1);
         }
         else {
-            Node* y = x->c[i];
-            y->key[y->n] = x->key[i]; // add median key to child
-            y->n += 1;
+            for (int j = x->n; j > 0; --j) // shift keys right
+                x->key[j] = x->key[j - 1];
+            for (int j = x->n + 1; j > 0; --j) // shift children right
+                x->c[j] = x->c[j - 1];
+            x->key[0] = s;
+            x->c[0] = a;
+            x->n += 1;
+            refresh(x);
+            balance(x, 0);
+        }
+        return top;
+    }
 
-            Node* z = x->c[i + 1];
-            for (int j = 0; j < z->n; ++j) // receive keys from right child
-                y->key[j + y->n] = z->key[j];
-            y->n += 1;
-            for (int j = 0; j <= z->n; ++j) // receive children from right child
-                y->c[j + y->n] = z->c[j];
-            y->n = (t<<1) - 1;
+    // the keys of subtree x smaller than lo, as a tree of their own
+    Node* keep_below(Node* x, const T& lo) {
+        stats.visit();
+        if (x->leaf) {
+            int i = find(x, lo);
+            for (int j = i; j < x->n; ++j)
+                delete_key(x->key[j]);
+            x->n = i;
+            return settle(x);
+        }
 
-            for (int j = i + 1; j < x->n; ++j) // shift x's keys left
-                x->key[j - 1] = x->key[j];
-            for (int j = i + 2; j <= x->n; ++j) // shift x's children left
-                x->c[j - 1] = x->c[j];
-            x->n -= 1;
+        int i = find(x, lo, true);
+        for (int j = i + 1; j <= x->n; ++j) // whole subtrees past lo
+            clear(x->c[j]);
+        for (int j = i; j < x->n; ++j)
+            delete_key(x->key[j]);
+        Node* y = keep_below(x->c[i], lo);
+        if (i == 0) {
+            drop_node(x);
+            return y;
+        }
+        T* s = x->key[i - 1];
+        x->n = i - 1;
+        return join(settle(x), s, y);
+    }
 
-            z->n = 0;
-            delete z;
+    // the keys of subtree x from hi on, as a tree of their own
+    Node* keep_from(Node* x, const T& hi) {
+        stats.visit();
+        if (x->leaf) {
+            int i = find(x, hi);
+            for (int j = 0; j < i; ++j)
+                delete_key(x->key[j]);
+            for (int j = i; j < x->n; ++j) // shift keys left
+                x->key[j - i] = x->key[j];
+            x->n -= i;
+            return settle(x);
+        }
 
-            erase(x->c[i], k);
+        int i = find(x, hi, true);
+        for (int j = 0; j < i; ++j) { // whole subtrees before hi
+            clear(x->c[j]);
+            delete_key(x->key[j]);
         }
+        Node* y = keep_from(x->c[i], hi);
+        if (i == x->n) {
+            drop_node(x);
+            return y;
+        }
+        T* s = x->key[i];
+        for (int j = i + 1; j < x->n; ++j) // shift keys left
+            x->key[j - i - 1] = x->key[j];
+        for (int j = i + 1; j <= x->n; ++j) // shift children left
+            x->c[j - i - 1] = x->c[j];
+        x->n -= i + 1;
+        return join(y, s, settle(x));
     }
 
-    void erase_3(Node* x, int i, T k) {
-        if ((i > 0 && x->c[i - 1]->n >= t) || (i < (t<<1) - 2 && x->c[i + 1]->n >= t)) return erase_3a(x, i, k);
-        return erase_3b(x, i, k);
+    // the keys of subtree x outside [lo, hi), as a tree of their own
+    Node* erase_range(Node* x, const T& lo, const T& hi) {
+        stats.visit();
+        if (x->leaf) {
+            int i = find(x, lo), j = find(x, hi);
+            for (int l = i; l < j; ++l)
+                delete_key(x->key[l]);
+            for (int l = j; l < x->n; ++l) // shift keys left
+                x->key[l - j + i] = x->key[l];
+            x->n -= j - i;
+            return settle(x);
+        }
+
+        int a = find(x, lo, true), b = find(x, hi, true);
+        Node* mid; // what is left of children a to b
+        if (a == b) {
+            int h = height(x);
+            mid = erase_range(x->c[a], lo, hi);
+            if (mid != nullptr && mid->n >= t - 1 && height(mid) == h - 1) { // x is still fine
+                x->c[a] = mid;
+                return x;
+            }
+        }
+        else {
+            for (int j = a + 1; j < b; ++j) // whole subtrees inside the range
+                clear(x->c[j]);
+            for (int j = a; j < b - 1; ++j)
+                delete_key(x->key[j]);
+            Node* y = keep_below(x->c[a], lo);
+            Node* z = keep_from(x->c[b], hi);
+            mid = join(y, x->key[b - 1], z);
+        }
+
+        // x falls apart into its children left of a, mid, and those right of b
+        T* sl = (a > 0 ? x->key[a - 1] : nullptr);
+        T* sr = (b < x->n ? x->key[b] : nullptr);
+        Node* right = nullptr;
+        if (sr != nullptr) {
+            right = new_node();
+            right->leaf = false;
+            stats.allocate();
+            for (int j = b + 1; j < x->n; ++j)
+                right->key[j - b - 1] = x->key[j];
+            for (int j = b + 1; j <= x->n; ++j)
+                right->c[j - b - 1] = x->c[j];
+            right->n = x->n - b - 1;
+            right = settle(right);
+        }
+        if (sl != nullptr) {
+            x->n = a - 1;
+            mid = join(settle(x), sl, mid);
+        }
+        else drop_node(x);
+        return (sr != nullptr ? join(mid, sr, right) : mid);
     }
 
-    void erase(Node* x, T k) {
-        int i = 0;
-        for (; i < x->n; ++i)
-            if (k <= *x->key[i]) break;
+    // points the last leaf with keys below lo at the first one with keys
+    // from hi on, past the leaves erasing [lo, hi) is about to free
+    void link(const T& lo, const T& hi) {
+        Node* left = nullptr; // nearest subtree left of the path to lo
+        Node* before = root;
+        while (!before->leaf) {
+            int i = find(before, lo, true);
+            if (i > 0) left = before->c[i - 1];
+            before = before->c[i];
+        }
+        if (find(before, lo) == 0) { // no key below lo in this leaf
+            if (left == nullptr) return;
+            for (before = left; !before->leaf; before = before->c[before->n]) {}
+        }
+
+        Node* after = root;
+        while (!after->leaf) after = after->c[find(after, hi, true)];
+        if (find(after, hi) == after->n) after = after->next;
+        if (before != after) before->next = after;
+    }
 
-        if (i < x->n && *x->key[i] == k) {
-            if (x->leaf) return erase_1(x, i);
-            return erase_2(x, i);
+    // a position in the leaves of a tree, done once x is null
+    struct Cursor {
+        Node* root;
+        Node* x;
+        int i;
+
+        explicit Cursor(Node* root) : root(root), x(root), i(0) {
+            if (x != nullptr)
+                while (!x->leaf) x = x->c[0];
+        }
+        bool done() const { return x == nullptr; }
+        const T& key() const { return *x->key[i]; }
+        void next() {
+            if (++i < x->n) return;
+            x = x->next;
+            i = 0;
         }
+    };
 
-        if (x->leaf) return;
+    // index of the first key >= k in leaf x from index i on, galloping
+    static int gallop(Node* x, int i, const T& k) {
+        int lo = i, hi = i, step = 1;
+        while (hi < x->n && *x->key[hi] < k) {
+            lo = hi + 1;
+            hi += step;
+            step <<= 1;
+        }
+        hi = min(hi, x->n);
+        return (int)(lower_bound(x->key + lo, x->key + hi, k, [](const T* a, const T& b) { return *a < b; }) - x->key);
+    }
 
-        if (x->c[i]->n >= t) return erase(x->c[i], k);
-        return erase_3(x, i, k);
+    // moves c to the first key >= k from where it is: within its leaf or
+    // the next one, or else down from the root, so short skips cost little
+    // and long ones no more than a search
+    void seek(Cursor& c, const T& k) {
+        if (c.done() || !(c.key() < k)) return;
+        if (*c.x->key[c.x->n - 1] < k) {
+            Node* y = c.x->next;
+            if (y != nullptr && *y->key[y->n - 1] < k) {
+                y = c.root;
+                while (!y->leaf) y = y->c[find(y, k, true)];
+            }
+            c.x = y;
+            c.i = 0;
+            if (y == nullptr) return;
+        }
+        c.i = gallop(c.x, c.i, k);
+        if (c.i == c.x->n) {
+            c.x = c.x->next;
+            c.i = 0;
+        }
     }
 
-    bool search(Node* x, T k) {
-        int i = 0;
-        for (; i < x->n; ++i)
-            if (k <= *x->key[i]) break;
+    // Replaces the content of the tree by the ascending distinct keys that
+    // f(emit) emits, built bottom-up as they come. The old content is freed
+    // only at the end, so f may read this tree.
+    template<typename F>
+    void rebuild(F f) {
+        vector<Node*> spine = {new_node()};
+        stats.allocate();
+        stats.grow();
+        f([&](const T& k) { append(spine, k); });
+        clear();
+        finish(spine);
+    }
 
-        if (i < x->n && *x->key[i] == k) return true;
-        if (x->leaf) return false;
-        return search(x->c[i], k);
+    // Two-stage recursive model index over the leaves, for arithmetic keys:
+    // a linear model picks one of many second-stage linear models, which
+    // predicts the position of the leaf whose range holds a key, off by at
+    // most its error bounds for every leaf it was trained on
+    struct Learned {
+        struct Line {
+            double a {}, b {}; // position ~ a * key + b
+            long lo {}, hi {}; // error bounds, actual - predicted
+        };
+        vector<T> low; // smallest key each leaf may hold, low[0] is unused
+        vector<Node*> leaf;
+        Line top; // predicts the index of a second-stage line
+        vector<Line> lines;
+        size_t shape {}; // tree shape it was trained on
+        size_t writes {}; // tree writes when it was trained
+        size_t every {}; // writes after which a stale model is retrained
+
+        // a * k + b, clamped to [0, m] before it can overflow a long
+        static long predict(const Line& l, T k, long m) { return (long)clamp(l.a * (double)k + l.b, 0.0, (double)m); }
+
+        // index of the leaf whose range holds k
+        size_t locate(T k) const {
+            long m = (long)low.size();
+            const Line& l = lines[predict(top, k, (long)lines.size() - 1)];
+            long p = predict(l, k, m);
+            long lo = clamp(p + l.lo, 1L, m), hi = clamp(p + l.hi + 1, 1L, m);
+            long u = upper_bound(low.begin() + lo, low.begin() + hi, k) - low.begin();
+            // keys between the trained ones may land past the bounds
+            if ((u == lo && lo > 1 && k < low[lo - 1]) || (u == hi && hi < m && low[hi] <= k))
+                u = upper_bound(low.begin() + 1, low.end(), k) - low.begin();
+            return (size_t)(u - 1);
+        }
+    };
+
+    // lists every leaf with the smallest key it may hold, from the separators
+    void collect(Node* x, const T* low, Learned& model) {
+        if (x->leaf) {
+            model.low.push_back(low != nullptr ? *low : T());
+            model.leaf.push_back(x);
+            return;
+        }
+        for (int i = 0; i <= x->n; ++i)
+            collect(x->c[i], (i > 0 ? x->key[i - 1] : low), model);
     }
 
-    void traverse(Node* x, function<void(T)> process) {
-        if (x == nullptr) return;
+    // fits l to the leaves [b, e) by least squares and records its error
+    static void fit(typename Learned::Line& l, const vector<T>& low, size_t b, size_t e) {
+        double n = (double)(e - b), sx = 0, sy = 0, sxx = 0, sxy = 0;
+        for (size_t i = b; i < e; ++i) {
+            double x = (double)low[i], y = (double)i;
+            sx += x;
+            sy += y;
+            sxx += x * x;
+            sxy += x * y;
+        }
+        double d = n * sxx - sx * sx;
+        l.a = (d > 0 ? (n * sxy - sx * sy) / d : 0);
+        l.b = (sy - l.a * sx) / n;
+        l.lo = l.hi = 0;
+        for (size_t i = b; i < e; ++i) {
+            long err = (long)i - Learned::predict(l, low[i], (long)low.size());
+            l.lo = min(l.lo, err);
+            l.hi = max(l.hi, err);
+        }
+    }
 
-        int i = 0;
-        for (; i < x->n; ++i) {
-            traverse(x->c[i], process);
-            process(*x->key[i]);
+    void train(size_t every) {
+        static_assert(is_arithmetic<T>::value, "the learned index models arithmetic keys");
+        model.reset(new Learned());
+        model->shape = shape;
+        model->writes = writes;
+        model->every = every;
+        if (root == nullptr) return;
+        collect(root, nullptr, *model);
+
+        vector<T>& low = model->low;
+        size_t m = low.size();
+        if (m > 1) low[0] = *model->leaf[0]->key[0]; // only for fitting, never compared
+        size_t f = max<size_t>(1, m / 16); // second-stage lines, 16 leaves each on average
+        model->lines.resize(f);
+
+        // the top line maps the key range onto [0, f) linearly
+        double span = (double)low[m - 1] - (double)low[0];
+        model->top.a = (span > 0 ? (double)f / span : 0);
+        model->top.b = -model->top.a * (double)low[0];
+
+        // keys are sorted and the top line increases, so each line gets a run
+        size_t b = 0;
+        for (size_t j = 0; j < f; ++j) {
+            size_t e = b;
+            while (e < m && Learned::predict(model->top, low[e], (long)f - 1) == (long)j) ++e;
+            if (e > b) fit(model->lines[j], low, b, e);
+            else model->lines[j].b = (double)b; // no leaf, point at the next one
+            b = e;
         }
-        if (!x->leaf) traverse(x->c[i], process);
     }
 
     int t {};
     Node* root {};
+    Stats stats {};
+    Blocks node_alloc;
+    Keys key_alloc;
+    size_t shape {}; // bumped whenever leaf boundaries may move
+    size_t writes {}; // inserts and erases so far
+    unique_ptr<Learned> model;
 
 public:
-    explicit BPlus(int t) : t(t) {}
+    explicit BPlus(int t, const Alloc& alloc = Alloc()) : t(t), node_alloc(alloc), key_alloc(alloc) {}
+    const Stats& statistics() const { return stats; }
     ~BPlus() { clear(); }
-    void clear() {}
+    void clear() {
+        if (root != nullptr) clear(root);
+        root = nullptr;
+        shape += 1;
+    }
     void insert(T k) {
+        writes += 1;
         if (root == nullptr) return create_root(k);
         if (root->n == (t<<1) - 1) split_root();
         insert_non_full(root, k);
     }
+    // Inserts an ascending range in a single walk over the tree: every leaf
+    // it touches is merged with its run of keys and split once.
+    template<typename It>
+    void insert_batch(It first, It last) {
+        if (first == last) return;
+        writes += distance(first, last);
+        if (root == nullptr) {
+            root = new_node();
+            stats.allocate();
+            stats.grow();
+            shape += 1;
+        }
+
+        auto extra = insert_batch(root, first, last, nullptr);
+        while (!extra.empty()) { // root overflowed, grow the tree
+            vector<T*> keys;
+            vector<Node*> children = {root};
+            for (auto& [sep, z] : extra) {
+                keys.push_back(sep);
+                children.push_back(z);
+            }
+            root = new_node();
+            root->leaf = false;
+            stats.allocate();
+            stats.grow();
+            shape += 1;
+            extra = pack(root, keys, children);
+        }
+    }
+    template<typename Range>
+    void insert_batch(const Range& sorted) {
+        insert_batch(begin(sorted), end(sorted));
+    }
+    // Replaces the content of the tree by an ascending random access range,
+    // built bottom-up: keys are copied into full leaves and every level of
+    // separators is laid out in turn, each step split among the threads.
+    // The threads allocate keys and nodes too if thread_safe_allocator says
+    // Alloc may be called from several at once; otherwise the calling thread
+    // allocates them all first, and the threads construct and fill them.
+    template<typename It>
+    void build(It first, It last, int threads = (int)thread::hardware_concurrency()) {
+        constexpr bool shared_alloc = thread_safe_allocator<Alloc>::value;
+        clear();
+        size_t m = last - first;
+        if (m == 0) return;
+        threads = max(threads, 1);
+
+        // keep the first key of every run of equal keys
+        int p = parts(m, threads);
+        vector<size_t> at(p + 1);
+        parallel(p, m, [&](int j, size_t lo, size_t hi) {
+            size_t cnt = 0;
+            for (size_t i = lo; i < hi; ++i)
+                cnt += (i == 0 || first[i - 1] < first[i]);
+            at[j + 1] = cnt;
+        });
+        for (int j = 0; j < p; ++j) at[j + 1] += at[j];
+        vector<T*> keys(at[p]);
+        if constexpr (!shared_alloc)
+            for (T*& k : keys) k = key_alloc.allocate(1);
+        parallel(p, m, [&](int j, size_t lo, size_t hi) {
+            size_t o = at[j];
+            for (size_t i = lo; i < hi; ++i)
+                if (i == 0 || first[i - 1] < first[i]) {
+                    if constexpr (shared_alloc) keys[o] = key_alloc.allocate(1);
+                    allocator_traits<Keys>::construct(key_alloc, keys[o++], first[i]);
+                }
+        });
+
+        size_t n = keys.size();
+        size_t q = (n + (t<<1) - 2) / ((t<<1) - 1); // full leaves, split evenly
+        vector<Node*> level(q);
+        vector<T*> seps(q - 1); // seps[j] goes between level[j] and level[j + 1]
+        if constexpr (!shared_alloc) {
+            for (Node*& x : level) x = new_node();
+            for (T*& k : seps) k = key_alloc.allocate(1);
+        }
+        parallel(parts(q, threads), q, [&](int, size_t lo, size_t hi) {
+            for (size_t j = lo; j < hi; ++j) {
+                size_t b = piece(j, q, n), e = piece(j + 1, q, n);
+                if constexpr (shared_alloc) {
+                    level[j] = new_node();
+                    if (j + 1 < q) seps[j] = key_alloc.allocate(1);
+                }
+                Node* x = level[j];
+                for (size_t i = b; i < e; ++i)
+                    x->key[i - b] = keys[i];
+                x->n = (int)(e - b);
+                refresh(x);
+                level[j] = x;
+                if (j + 1 < q)
+                    allocator_traits<Keys>::construct(key_alloc, seps[j], separator_value(*keys[e - 1], *keys[e]));
+            }
+        });
+        parallel(parts(q, threads), q - 1, [&](int, size_t lo, size_t hi) {
+            for (size_t j = lo; j < hi; ++j)
+                level[j]->next = level[j + 1];
+        });
+        for (size_t j = 0; j < q; ++j) stats.allocate();
+        stats.grow();
+        shape += 1;
+
+        while (level.size() > 1) {
+            size_t c = level.size();
+            q = (c + (t<<1) - 1) / (t<<1); // full internal nodes, split evenly
+            vector<Node*> up(q);
+            if constexpr (!shared_alloc)
+                for (Node*& x : up) x = new_node();
+            vector<T*> up_seps(q - 1);
+            parallel(parts(q, threads), q, [&](int, size_t lo, size_t hi) {
+                for (size_t j = lo; j < hi; ++j) {
+                    size_t b = piece(j, q, c), e = piece(j + 1, q, c);
+                    if constexpr (shared_alloc) up[j] = new_node();
+                    Node* x = up[j];
+                    x->leaf = false;
+                    for (size_t i = b; i < e; ++i)
+                        x->c[i - b] = level[i];
+                    for (size_t i = b; i + 1 < e; ++i)
+                        x->key[i - b] = seps[i];
+                    x->n = (int)(e - b - 1);
+                    refresh(x);
+                    up[j] = x;
+                    if (j + 1 < q) up_seps[j] = seps[e - 1]; // key between both nodes moves up
+                }
+            });
+            level.swap(up);
+            seps.swap(up_seps);
+            for (size_t j = 0; j < q; ++j) stats.allocate();
+            stats.grow();
+            shape += 1;
+        }
+        root = level[0];
+    }
+    template<typename Range>
+    void build(const Range& sorted, int threads = (int)thread::hardware_concurrency()) {
+        build(begin(sorted), end(sorted), threads);
+    }
+    // Replaces the content of the tree by the keys of a binary stream of T
+    // (native byte order) in any order and of any size: an external merge
+    // sort within about `memory` bytes streams them, sorted, into full
+    // leaves and separator levels built bottom-up as they fill. Throws
+    // runtime_error, leaving the tree empty, if the stream ends in a partial
+    // key or a temporary file cannot be written.
+    void load(istream& in, size_t memory = size_t(256) << 20) {
+        clear();
+        vector<Node*> spine = {new_node()};
+        stats.allocate();
+        stats.grow();
+        T* last = nullptr;
+        try {
+            external_sort<T>(in, memory, [&](const T& k) {
+                if (last != nullptr && !(*last < k)) return; // duplicate
+                append(spine, k);
+                last = spine[0]->key[spine[0]->n - 1];
+            });
+        }
+        catch (...) {
+            finish(spine);
+            clear();
+            throw;
+        }
+        finish(spine);
+    }
+    // Writes the keys, leaf by leaf, to a tree file (see TreeFile.h)
+    void save(ostream& out) const {
+        Node* first = root;
+        int height = 0;
+        for (; first != nullptr && !first->leaf; first = first->c[0]) height += 1;
+        uint64_t count = 0;
+        for (Node* x = first; x != nullptr; x = x->next) count += x->n;
+
+        TreeWriter<T> w(out, t, height, count);
+        for (Node* x = first; x != nullptr; x = x->next)
+            for (int i = 0; i < x->n; ++i)
+                w.key(*x->key[i]);
+        w.finish();
+    }
+    // Replaces the content of the tree by the keys of a tree file that
+    // BPlus::save or BTree::save wrote, of any order, streamed in large
+    // reads into full leaves and separator levels built bottom-up. Throws
+    // runtime_error if the file is damaged, leaving the tree empty unless
+    // its header was.
+    void restore(istream& in) {
+        TreeReader<T> r(in);
+        clear();
+        vector<Node*> spine = {new_node()};
+        stats.allocate();
+        stats.grow();
+        try {
+            T k;
+            for (uint64_t i = 0; i < r.count; ++i) {
+                r.key(k);
+                append(spine, k);
+            }
+            r.finish();
+        }
+        catch (...) {
+            finish(spine);
+            clear();
+            throw;
+        }
+        finish(spine);
+    }
+    // Replace the content of the tree by the union, intersection or
+    // difference of a and b (this tree among them, possibly), merging their
+    // leaves in order into a tree built bottom-up. Intersection and
+    // difference skip ahead in the other tree by galloping, so a small set
+    // against a large one costs about a search per key of the small one.
+    void set_union(const BPlus& a, const BPlus& b) {
+        rebuild([&](auto emit) {
+            Cursor x(a.root), y(b.root);
+            while (!x.done() && !y.done()) {
+                if (x.key() < y.key()) {
+                    emit(x.key());
+                    x.next();
+                }
+                else {
+                    if (!(y.key() < x.key())) x.next();
+                    emit(y.key());
+                    y.next();
+                }
+            }
+            for (; !x.done(); x.next()) emit(x.key());
+            for (; !y.done(); y.next()) emit(y.key());
+        });
+    }
+    void set_intersection(const BPlus& a, const BPlus& b) {
+        rebuild([&](auto emit) {
+            Cursor x(a.root), y(b.root);
+            while (!x.done() && !y.done()) {
+                if (x.key() < y.key()) seek(x, y.key());
+                else if (y.key() < x.key()) seek(y, x.key());
+                else {
+                    emit(x.key());
+                    x.next();
+                    y.next();
+                }
+            }
+        });
+    }
+    void set_difference(const BPlus& a, const BPlus& b) {
+        rebuild([&](auto emit) {
+            Cursor x(a.root), y(b.root);
+            while (!x.done()) {
+                if (!y.done()) seek(y, x.key());
+                if (y.done() || x.key() < y.key()) emit(x.key());
+                x.next();
+            }
+        });
+    }
     void erase(T k) {
+        writes += 1;
         if (root == nullptr) return;
         erase(root, k);
         if (root->n == 0) {
             Node* temp = root;
             root = (root->leaf ? nullptr : root->c[0]);
-            delete temp;
+            delete_node(temp);
+            stats.shrink();
+            shape += 1;
         }
     }
+    // Erases every key k with lo <= k < hi in one pass: subtrees inside the
+    // range are freed whole, only the nodes on the paths to lo and hi are
+    // cut, and what is left on either side is joined back into one tree.
+    void erase_range(const T& lo, const T& hi) {
+        if (root == nullptr || !(lo < hi)) return;
+        writes += 1;
+        link(lo, hi);
+        root = erase_range(root, lo, hi);
+        shape += 1;
+    }
+    // Trains a learned index over the leaves (arithmetic keys only) that
+    // search uses instead of descending the tree, for as long as no split,
+    // merge or borrow moves a leaf boundary. A stale index is retrained by
+    // the first search that comes after `every` more writes.
+    void learn(size_t every = 4096) { train(every); }
+    void forget() { model.reset(); }
     bool search(T k) {
         if (root == nullptr) return false;
+        if constexpr (is_arithmetic<T>::value) {
+            if (model && model->shape != shape && writes - model->writes >= model->every)
+                train(model->every);
+            if (model && model->shape == shape) {
+                Node* x = model->leaf[model->locate(k)];
+                stats.visit();
+                // binary search, each key compared is a pointer to chase
+                T** p = lower_bound(x->key, x->key + x->n, k, [](const T* a, T b) { return *a < b; });
+                return p != x->key + x->n && **p == k;
+            }
+        }
         return search(root, k);
     }
     void traverse(function<void(T)> process) {
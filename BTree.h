@@ -6,10 +6,20 @@
 #define AED_TRIEB_BTREE_H
 
 #include <iostream>
+#include <atomic>
+#include <cstddef>
 #include <functional>
+#include <memory>
+#include <new>
+#include <optional>
+#include <thread>
+#include <vector>
+#include "FrozenTree.h"
+#include "Stats.h"
+#include "TreeFile.h"
 using namespace std;
 
-template<typename T>
+template<typename T, typename Stats = NoStats, typename Alloc = allocator<T>>
 class BTree {
     class Node {
         int n {}; // number of keys
@@ -17,37 +27,57 @@ class BTree {
         Node** c {}; // array of pointers to children
         bool leaf {}; // boolean, true if it is a leaf
         friend BTree;
+    };
 
-    public:
-        Node() : leaf(true) {}
-        explicit Node(int t) {
-            int m = (t<<1); // order of tree
-            n = 0;
-            leaf = true;
-
-            key = new T[m - 1];
+    // A node and its arrays of keys and children share a single block from
+    // the allocator, counted in max_align_t units so that any allocator
+    // (std::pmr included) returns it suitably aligned
+    using Blocks = typename allocator_traits<Alloc>::template rebind_alloc<max_align_t>;
+    using Keys = typename allocator_traits<Alloc>::template rebind_alloc<T>;
+    static_assert(alignof(T) <= alignof(max_align_t), "BTree keys must not be over-aligned");
+
+    static size_t align(size_t bytes, size_t a) { return (bytes + a - 1) / a * a; }
+    size_t key_offset() const { return align(sizeof(Node), alignof(T)); }
+    size_t child_offset() const { return align(key_offset() + ((t<<1) - 1) * sizeof(T), alignof(Node*)); }
+    size_t units() const { return align(child_offset() + (t<<1) * sizeof(Node*), sizeof(max_align_t)) / sizeof(max_align_t); }
+
+    Node* new_node() {
+        int m = (t<<1); // order of tree
+        char* p = (char*)node_alloc.allocate(units());
+        Node* x = new (p) Node();
+        x->leaf = true;
+
+        x->key = (T*)(p + key_offset());
+        for (int i = 1; i < m; ++i)
+            allocator_traits<Keys>::construct(key_alloc, x->key + i - 1);
+
+        x->c = (Node**)(p + child_offset());
+        for (int i = 0; i < m; ++i)
+            x->c[i] = nullptr;
+        return x;
+    }
 
-            c = new Node*[m];
-            for (int i = 0; i < m; ++i)
-                c[i] = nullptr;
-        }
-        ~Node() {
-            delete key;
-            for (int i = 0; i < (n<<1); ++i)
-                delete c[i];
-            delete[] c;
-        }
-    };
+    // frees x, not its children
+    void delete_node(Node* x) {
+        for (int i = 1; i < (t<<1); ++i)
+            allocator_traits<Keys>::destroy(key_alloc, x->key + i - 1);
+        x->~Node();
+        node_alloc.deallocate((max_align_t*)x, units());
+    }
 
     void create_root(T k) {
-        root = new Node(t);
+        root = new_node();
+        stats.allocate();
+        stats.grow();
         root->n = 1;
         root->key[0] = k;
     }
 
     void split_root() {
-        Node* s = new Node(t);
+        Node* s = new_node();
         s->leaf = false;
+        stats.allocate();
+        stats.grow();
 
         s->c[0] = root;
         root = s;
@@ -66,7 +96,9 @@ class BTree {
         int m = t - 1; // median of child's keys' array
         Node* y = x->c[i];
 
-        Node* z = new Node(t);
+        Node* z = new_node();
+        stats.allocate();
+        stats.split();
         for (int j = 0; j < m; ++j) // assign to z, y's greatest keys
             z->key[j] = y->key[j + t];
 
@@ -83,13 +115,15 @@ class BTree {
     }
 
     void insert_non_full(Node* x, T k) {
+        stats.visit();
         int i = 0;
         for (; i < x->n; ++i)
             if (k <= x->key[i]) break;
+        stats.compare(min(i + 1, x->n));
 
         if (i < x->n && x->key[i] == k) return;
         if (x->leaf) {
-            for (int j = i + 1; j <= x->n; ++j)
+            for (int j = x->n; j > i; --j) // shift keys right
                 x->key[j] = x->key[j - 1];
             x->key[i] = k;
             x->n += 1;
@@ -103,16 +137,40 @@ class BTree {
         return insert_non_full(x->c[i], k);
     }
 
-    int predecessor(Node* x) {
+    T predecessor(Node* x) {
         if (x->leaf) return x->key[x->n - 1];
         return predecessor(x->c[x->n]);
     }
 
-    int successor(Node* x) {
+    T successor(Node* x) {
         if (x->leaf) return x->key[0];
         return successor(x->c[0]);
     }
 
+    // merges x->c[i + 1] and the key between them into x->c[i]
+    void merge(Node* x, int i) {
+        stats.merge();
+        Node* y = x->c[i];
+        Node* z = x->c[i + 1];
+
+        y->key[y->n] = x->key[i]; // add median key to y
+        for (int j = 0; j < z->n; ++j) // receive keys from right child
+            y->key[y->n + 1 + j] = z->key[j];
+        if (!y->leaf)
+            for (int j = 0; j <= z->n; ++j) // receive children from right child
+                y->c[y->n + 1 + j] = z->c[j];
+        y->n += z->n + 1;
+
+        for (int j = i + 1; j < x->n; ++j) // shift x's keys left
+            x->key[j - 1] = x->key[j];
+        for (int j = i + 2; j <= x->n; ++j) // shift x's children left
+            x->c[j - 1] = x->c[j];
+        x->c[x->n] = nullptr;
+        x->n -= 1;
+
+        delete_node(z);
+    }
+
     void erase_1(Node* x, int i) {
         for (int j = i + 1; j < x->n; ++j) // shift keys left
             x->key[j - 1] = x->key[j];
@@ -131,58 +189,44 @@ class BTree {
     }
 
     void erase_2c(Node* x, int i) {
-        Node* y = x->c[i];
-        Node* z = x->c[i + 1];
-
-        y->n = (t<<1) - 1;
-        y->key[t - 1] = x->key[i];
-        for (int j = 0; j < t - 1; ++j) // merge keys in y
-            y->key[j + t] = z->key[j];
-        for (int j = 0; j < t; ++j) // merge children in y
-            y->c[j + t] = z->c[j]; // CRAZY ERROR for using y[j + t]
-
-        for (int j = i + 1; j < x->n; ++j) // shift left keys in x
-            x->key[j - 1] = x->key[j];
-        for (int j = i + 1; j < x->n; ++j) // shift left children in x
-            x->c[j] = x->c[j + 1];
-
-
-        x->c[x->n] = nullptr;
-        x->n -= 1; // reduce x's key count
-
-        delete z;
-
-        erase(x->c[i], y->key[t - 1]);
+        T k = x->key[i];
+        merge(x, i);
+        erase(x->c[i], k);
     }
 
+    // x->key[i] is k and x is internal
     void erase_2(Node* x, int i) {
         if (x->c[i]->n >= t) return erase_2a(x, i);
-        if (x->c[i+1]->n >= t) return erase_2b(x, i);
+        if (x->c[i + 1]->n >= t) return erase_2b(x, i);
         return erase_2c(x, i);
     }
 
-    void erase_3a(Node* x, int i, T k) {
+    // moves the last key of x->c[i - 1] up into x and the key there down
+    // into the front of x->c[i], along with the child between them
+    void borrow_left(Node* x, int i) {
         Node* y = x->c[i];
-        if (i > 0 && x->c[i - 1]->n >= t) {
-            for (int j = 0; j < y->n; ++j) // shift all keys right
-                y->key[j + 1] = y->key[j];
-            for (int j = 0; j <= y->n; ++j) // shift all children right
-                y->c[i + 1] = y->c[i];
-            y->n += 1; // update y's key count
-
-            Node* z = x->c[i - 1]; // left child (from whom a key & child are borrowed)
-            y->key[0] = x->key[i - 1]; // add key to y
-            y->c[0] = z->c[z->n]; // add child to y
-
-            z->n -= 1;
-            x->key[i - 1] = z->key[z->n];
-            z->c[z->n] = nullptr;
+        Node* z = x->c[i - 1]; // left child (from whom a key & child are borrowed)
+        for (int j = y->n; j > 0; --j) // shift all keys right
+            y->key[j] = y->key[j - 1];
+        if (!y->leaf)
+            for (int j = y->n + 1; j > 0; --j) // shift all children right
+                y->c[j] = y->c[j - 1];
+        y->n += 1; // update y's key count
+
+        y->key[0] = x->key[i - 1]; // add key to y
+        y->c[0] = z->c[z->n]; // add child to y
+        x->key[i - 1] = z->key[z->n - 1];
+        z->c[z->n] = nullptr;
+        z->n -= 1;
+    }
 
-            erase(x->c[i], k);
-        }
+    // x->c[i] has t - 1 keys, borrow one from a sibling with t or more
+    void erase_3a(Node* x, int i, T k) {
+        stats.borrow();
+        Node* y = x->c[i];
+        if (i > 0 && x->c[i - 1]->n >= t) borrow_left(x, i);
         else {
             Node* z = x->c[i + 1]; // right child (from whom a key & child are borrowed)
-
             y->key[y->n] = x->key[i]; // add key to y
             y->n += 1;
             y->c[y->n] = z->c[0]; // add child to y
@@ -192,88 +236,46 @@ class BTree {
                 z->key[j - 1] = z->key[j];
             for (int j = 1; j <= z->n; ++j)
                 z->c[j - 1] = z->c[j];
-
             z->c[z->n] = nullptr;
             z->n -= 1;
-
-            erase(x->c[i], k);
         }
+        erase(x->c[i], k);
     }
 
+    // x->c[i] and its siblings have t - 1 keys, merge it with one
     void erase_3b(Node* x, int i, T k) {
-        if (i > 0) {
-            Node* y = x->c[i - 1];
-            y->key[y->n] = x->key[i - 1]; // add median key to left child
-            y->n += 1;
-
-            Node* z = x->c[i];
-            for (int j = 0; j < z->n; ++j) // pass keys to left child
-                y->key[j + y->n] = z->key[j];
-            y->n += 1;
-            for (int j = 0; j <= z->n; ++j) // pass children to left child
-                y->c[j + y->n] = z->c[j];
-            y->n = (t<<1) - 1;
-
-            for (int j = i; j < x->n; ++j) // shift x's keys left
-                x->key[j - 1] = x->key[j];
-            for (int j = i + 1; j <= x->n; ++j) // shift x's children left
-                x->c[j - 1] = x->c[j];
-            x->n -= 1;
-
-            delete z;
-
-            erase(x->c[i - 1], k);
-        }
-        else {
-            Node* y = x->c[i];
-            y->key[y->n] = x->key[i]; // add median key to child
-            y->n += 1;
-
-            Node* z = x->c[i + 1];
-            for (int j = 0; j < z->n; ++j) // receive keys from right child
-                y->key[j + y->n] = z->key[j];
-            y->n += 1;
-            for (int j = 0; j <= z->n; ++j) // receive children from right child
-                y->c[j + y->n] = z->c[j];
-            y->n = (t<<1) - 1;
-
-            for (int j = i + 1; j < x->n; ++j) // shift x's keys left
-                x->key[j - 1] = x->key[j];
-            for (int j = i + 2; j <= x->n; ++j) // shift x's children left
-                x->c[j - 1] = x->c[j];
-            x->n -= 1;
-
-            delete z;
-
-            erase(x->c[i], k);
-        }
+        if (i == x->n) i -= 1;
+        merge(x, i);
+        erase(x->c[i], k);
     }
 
+    // makes sure x->c[i] has at least t keys before descending into it
     void erase_3(Node* x, int i, T k) {
-        if ((i > 0 && x->c[i - 1] >= t) || (i < (t<<1) - 2 && x->c[i + 1] >= t)) return erase_3a(x, i, k);
+        if ((i > 0 && x->c[i - 1]->n >= t) || (i < x->n && x->c[i + 1]->n >= t)) return erase_3a(x, i, k);
         return erase_3b(x, i, k);
     }
 
     void erase(Node* x, T k) {
+        stats.visit();
         int i = 0;
         for (; i < x->n; ++i)
             if (k <= x->key[i]) break;
+        stats.compare(min(i + 1, x->n));
         if (i < x->n && x->key[i] == k) {
             if (x->leaf) return erase_1(x, i);
-            else if (i > 0 && x->c[i - 1]->n >= t) return erase_2a(x, i);
-            else if (i < (t<<1) - 2 && x->c[i + 1]->n >= t) return erase_2b(x, i);
-            else erase_2c(x, i);
+            return erase_2(x, i);
         }
         if (x->leaf) return;
         if (x->c[i]->n >= t) return erase(x->c[i], k);
-        if ((i > 0 && x->c[i - 1]->n >= t) || (i < (t<<1) - 2 && x->c[i + 1]->n >= t)) return erase_3a(x, i, k);
-        return erase_3b(x, i, k);
+        return erase_3(x, i, k);
     }
 
     bool search(Node* x, T k) {
+        stats.visit();
         int i = 0;
         for (; i < x->n; ++i)
             if (k <= x->key[i]) break;
+        stats.compare(min(i + 1, x->n));
 
         if (i < x->n && x->key[i] == k) return true;
         if (x->leaf) return false;
@@ -282,6 +284,7 @@ class BTree {
 
     void traverse(Node* x, function<void(T)> process) {
         if (x == nullptr) return;
+        stats.visit();
 
         int i = 0;
         for (; i < x->n; ++i) {
@@ -292,13 +295,235 @@ class BTree {
         if (!x->leaf) traverse(x->c[i], process);
     }
 
+    void clear(Node* x) {
+        if (!x->leaf)
+            for (int i = 0; i <= x->n; ++i)
+                clear(x->c[i]);
+        delete_node(x);
+    }
+
+    static size_t count(Node* x) {
+        size_t n = x->n;
+        if (!x->leaf)
+            for (int i = 0; i <= x->n; ++i)
+                n += count(x->c[i]);
+        return n;
+    }
+
+    // Bottom-up build from a stream of ascending distinct keys. spine[h] is
+    // the rightmost node of level h, the only one still open: once a leaf
+    // is full the next key goes up, between it and a new leaf.
+    void append(vector<Node*>& spine, const T& k) {
+        Node* x = spine[0];
+        if (x->n < (t<<1) - 1) {
+            x->key[x->n] = k;
+            x->n += 1;
+            return;
+        }
+        Node* z = new_node();
+        stats.allocate();
+        push_up(spine, 1, k, z);
+        spine[0] = z;
+    }
+
+    // adds child z after the open node of level h - 1, k between them
+    void push_up(vector<Node*>& spine, size_t h, const T& k, Node* z) {
+        if (h == spine.size()) { // the tree grows a root
+            Node* s = new_node();
+            s->leaf = false;
+            s->c[0] = spine[h - 1];
+            spine.push_back(s);
+            stats.allocate();
+            stats.grow();
+        }
+        Node* x = spine[h];
+        if (x->n == (t<<1) - 1) { // full, z starts the next node and k moves up
+            Node* s = new_node();
+            s->leaf = false;
+            s->c[0] = z;
+            stats.allocate();
+            push_up(spine, h + 1, k, s);
+            spine[h] = s;
+            return;
+        }
+        x->key[x->n] = k;
+        x->c[x->n + 1] = z;
+        x->n += 1;
+    }
+
+    // the open nodes may hold too few keys, they borrow from their left
+    // sibling, which is full. Top-down, since an open node may have no left
+    // sibling under its parent until the parent itself has borrowed.
+    void finish(vector<Node*>& spine) {
+        for (size_t h = spine.size() - 1; h-- > 0;) {
+            Node* x = spine[h + 1];
+            while (spine[h]->n < t - 1)
+                borrow_left(x, x->n);
+        }
+        root = spine.back();
+        if (root->n == 0) {
+            delete_node(root);
+            root = nullptr;
+        }
+    }
+
+    // moves the first m keys of x->c[i + 1], and the children left of them,
+    // to the end of x->c[i] through the key between both
+    void shift_left(Node* x, int i, int m) {
+        Node* y = x->c[i];
+        Node* z = x->c[i + 1];
+        y->key[y->n] = x->key[i];
+        for (int j = 0; j < m - 1; ++j)
+            y->key[y->n + 1 + j] = z->key[j];
+        if (!y->leaf)
+            for (int j = 0; j < m; ++j)
+                y->c[y->n + 1 + j] = z->c[j];
+        x->key[i] = z->key[m - 1];
+
+        for (int j = m; j < z->n; ++j) // shift z's keys left
+            z->key[j - m] = z->key[j];
+        if (!z->leaf)
+            for (int j = m; j <= z->n; ++j) // shift z's children left
+                z->c[j - m] = z->c[j];
+        y->n += m;
+        z->n -= m;
+    }
+
+    // fills x->c[i] up from x->c[i + 1]: merges them if they fit in one node
+    // and x can spare the key between them, returns whether it did
+    bool fill(Node* x, int i) {
+        Node* y = x->c[i];
+        Node* z = x->c[i + 1];
+        if (y->n + z->n + 1 <= (t<<1) - 1 && (x == root || x->n >= t)) {
+            merge(x, i);
+            return true;
+        }
+        int m = min((t<<1) - 1 - y->n, z->n - (t - 1)); // z keeps t - 1
+        if (m > 0) shift_left(x, i, m);
+        return false;
+    }
+
+    // copies x into a fresh block, the old one is freed after the slice so
+    // that the copies do not just take each other's place
+    Node* relocate(Node* x) {
+        Node* y = new_node();
+        stats.allocate();
+        y->leaf = x->leaf;
+        y->n = x->n;
+        for (int j = 0; j < x->n; ++j)
+            y->key[j] = x->key[j];
+        if (!x->leaf)
+            for (int j = 0; j <= x->n; ++j)
+                y->c[j] = x->c[j];
+        retired.push_back(x);
+        return y;
+    }
+
+    // Compacts the children of x right of the key `from` (all of them if
+    // null), in key order: each one is filled up from those after it, then
+    // compacted below, which it can now spare keys for, then relocated.
+    // Every child done spends one of budget; when it runs out, the key after
+    // the last child done is kept in resume and false is returned.
+    bool compact(Node* x, const T* from, size_t& budget) {
+        if (x->leaf) return true;
+        int i = 0;
+        if (from != nullptr)
+            while (i < x->n && !(*from < x->key[i])) ++i;
+        for (; i <= x->n; ++i) {
+            while (i < x->n && fill(x, i)) {}
+            if (!compact(x->c[i], from, budget)) return false;
+            from = nullptr;
+            x->c[i] = relocate(x->c[i]);
+
+            if (budget > 0) budget -= 1;
+            if (budget == 0 && i < x->n) {
+                resume = x->key[i];
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // A piece of an in-order walk: the whole subtree x, or only its key i
+    struct Task {
+        Node* x;
+        int i; // -1 for the whole subtree
+    };
+
+    // cuts the tree at its upper levels into at least n pieces (fewer if
+    // the tree runs out of levels), listed in key order
+    vector<Task> split_tasks(size_t n) {
+        vector<Task> tasks = {{root, -1}};
+        bool cut = true;
+        while (tasks.size() < n && cut) {
+            cut = false;
+            vector<Task> next;
+            for (const Task& task : tasks) {
+                Node* x = task.x;
+                if (task.i >= 0 || x->leaf) {
+                    next.push_back(task);
+                    continue;
+                }
+                for (int i = 0; i < x->n; ++i) {
+                    next.push_back({x->c[i], -1});
+                    next.push_back({x, i});
+                }
+                next.push_back({x->c[x->n], -1});
+                cut = true;
+            }
+            tasks.swap(next);
+        }
+        return tasks;
+    }
+
+    template<typename F>
+    static void walk(Node* x, F& f) {
+        for (int i = 0; i < x->n; ++i) {
+            if (!x->leaf) walk(x->c[i], f);
+            f(x->key[i]);
+        }
+        if (!x->leaf) walk(x->c[x->n], f);
+    }
+
+    template<typename F>
+    static void walk(const Task& task, F& f) {
+        if (task.i < 0) walk(task.x, f);
+        else f(task.x->key[task.i]);
+    }
+
+    // runs work(j) for every j in [0, n) on p threads, each one claiming
+    // the next j as soon as it is done with the last
+    template<typename W>
+    static void parallel(int p, size_t n, W work) {
+        atomic<size_t> next {0};
+        auto worker = [&]() {
+            for (size_t j = next++; j < n; j = next++)
+                work(j);
+        };
+        vector<thread> pool;
+        for (int j = 1; j < p; ++j)
+            pool.emplace_back(worker);
+        worker();
+        for (thread& th : pool) th.join();
+    }
+
     int t {};
     Node* root {};
+    Stats stats {};
+    Blocks node_alloc;
+    Keys key_alloc;
+    vector<Node*> retired; // blocks relocate replaced
+    optional<T> resume; // where the next compact slice starts
 
 public:
-    explicit BTree(int t) : t(t) {}
+    explicit BTree(int t, const Alloc& alloc = Alloc()) : t(t), node_alloc(alloc), key_alloc(alloc) {}
+    const Stats& statistics() const { return stats; }
     ~BTree() { clear(); }
-    void clear() {}
+    void clear() {
+        if (root != nullptr) clear(root);
+        root = nullptr;
+        resume.reset();
+    }
     void insert(T k) {
         if (root == nullptr) return create_root(k);
         if (root->n == (t<<1) - 1) split_root();
@@ -307,8 +532,72 @@ public:
     void erase(T k) {
         if (root == nullptr) return;
         erase(root, k);
-        if (root->n == 0)
+        if (root->n == 0) {
+            Node* temp = root;
             root = (root->leaf ? nullptr : root->c[0]);
+            delete_node(temp);
+            stats.shrink();
+        }
+    }
+    // Gives back the memory erase-heavy churn leaves behind, a slice at a
+    // time so it can run between requests: each call handles about `slice`
+    // nodes and the next one goes on from there. Going through the tree in
+    // key order, every node is filled up from its right sibling, or merged
+    // with it when they fit, and moved to a fresh block, which may land
+    // closer to its neighbours. On a std::pmr::monotonic_buffer_resource that
+    // only helps locality: freed blocks are not reused, so the arena grows by
+    // every node moved. Returns true when a pass over the tree is done.
+    bool compact(size_t slice = 256) {
+        if (root == nullptr) return true;
+        optional<T> from = resume;
+        resume.reset();
+        size_t budget = max<size_t>(slice, 1);
+        bool done = compact(root, from ? &*from : nullptr, budget);
+        if (root->n == 0) { // its children merged into one
+            Node* temp = root;
+            root = root->c[0];
+            delete_node(temp);
+            stats.shrink();
+        }
+        else if (done) root = relocate(root);
+
+        for (Node* x : retired) delete_node(x);
+        retired.clear();
+        return done;
+    }
+    // Writes the keys in order to a tree file (see TreeFile.h)
+    void save(ostream& out) {
+        int height = 0;
+        for (Node* x = root; x != nullptr && !x->leaf; x = x->c[0]) height += 1;
+        TreeWriter<T> w(out, t, height, root != nullptr ? count(root) : 0);
+        auto put = [&w](const T& k) { w.key(k); };
+        if (root != nullptr) walk(root, put);
+        w.finish();
+    }
+    // Replaces the content of the tree by the keys of a tree file that
+    // BTree::save or BPlus::save wrote, of any order, streamed in large
+    // reads into full nodes built bottom-up. Throws runtime_error if the
+    // file is damaged, leaving the tree empty unless its header was.
+    void restore(istream& in) {
+        TreeReader<T> r(in);
+        clear();
+        vector<Node*> spine = {new_node()};
+        stats.allocate();
+        stats.grow();
+        try {
+            T k;
+            for (uint64_t i = 0; i < r.count; ++i) {
+                r.key(k);
+                append(spine, k);
+            }
+            r.finish();
+        }
+        catch (...) {
+            finish(spine);
+            clear();
+            throw;
+        }
+        finish(spine);
     }
     bool search(T k) {
         if (root == nullptr) return false;
@@ -318,6 +607,47 @@ public:
         if (root == nullptr) return;
         return traverse(root, process);
     }
+    // Copies the keys into a pointer-free FrozenTree for read-only lookups,
+    // leaving this tree as it is
+    FrozenTree<T> freeze() {
+        vector<T> keys;
+        auto push = [&keys](const T& k) { keys.push_back(k); };
+        if (root != nullptr) walk(root, push);
+        return FrozenTree<T>(keys);
+    }
+    // Calls f on every key from several threads at once, in no particular
+    // order, so f must be safe to call concurrently. The upper levels are
+    // cut into 16 pieces per thread and threads take pieces as they go.
+    template<typename F>
+    void for_each(F f, int threads = (int)thread::hardware_concurrency()) {
+        if (root == nullptr) return;
+        threads = max(threads, 1);
+        vector<Task> tasks = split_tasks((size_t)threads * 16);
+        parallel(threads, tasks.size(), [&](size_t j) { walk(tasks[j], f); });
+    }
+    // Folds map(k) over the keys in ascending order with combine, starting
+    // from init. Pieces of the tree are folded in parallel as for_each does
+    // and their results are combined in key order, so combine only needs to
+    // be associative.
+    template<typename R, typename Map, typename Combine>
+    R reduce(R init, Map map, Combine combine, int threads = (int)thread::hardware_concurrency()) {
+        if (root == nullptr) return init;
+        threads = max(threads, 1);
+        vector<Task> tasks = split_tasks((size_t)threads * 16);
+        vector<optional<R>> part(tasks.size());
+        parallel(threads, tasks.size(), [&](size_t j) {
+            optional<R> acc; // local, so threads do not share cache lines per key
+            auto fold = [&](const T& k) {
+                if (acc) *acc = combine(move(*acc), map(k));
+                else acc.emplace(map(k));
+            };
+            walk(tasks[j], fold);
+            part[j] = move(acc);
+        });
+        for (optional<R>& p : part)
+            if (p) init = combine(move(init), move(*p));
+        return init;
+    }
 };
 
 #endif //AED_TRIEB_BTREE_H
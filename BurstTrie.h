@@ -0,0 +1,188 @@
+#ifndef AED_TRIEB_BURSTTRIE_H
+#define AED_TRIEB_BURSTTRIE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+using namespace std;
+
+// Trie whose deep, sparse levels are replaced by buckets: a slot of a trie
+// node either leads to another trie node or to a bucket holding the sorted
+// suffixes of every word below it, packed in a single buffer. A bucket that
+// grows past the limit bursts into a new trie node with one bucket per
+// distinct first byte. Dense prefixes pay one array index per byte, and
+// sparse tails pay one binary search instead of a chain of nodes.
+class BurstTrie {
+    class Bucket {
+        string data; // suffixes back to back, in sorted order
+        vector<uint32_t> start; // start[i] is where suffix i begins in data
+        friend BurstTrie;
+
+        int size() const { return (int)start.size(); }
+        string_view at(int i) const {
+            uint32_t end = (i + 1 < size() ? start[i + 1] : (uint32_t)data.size());
+            return string_view(data).substr(start[i], end - start[i]);
+        }
+        // index of the first suffix >= s
+        int rank(string_view s) const {
+            int lo = 0, hi = size();
+            while (lo < hi) {
+                int mid = (lo + hi) / 2;
+                if (at(mid) < s) lo = mid + 1;
+                else hi = mid;
+            }
+            return lo;
+        }
+        bool contains(string_view s) const {
+            int i = rank(s);
+            return i < size() && at(i) == s;
+        }
+        // returns false if s was already there
+        bool insert(string_view s) {
+            int i = rank(s);
+            if (i < size() && at(i) == s) return false;
+            uint32_t pos = (i < size() ? start[i] : (uint32_t)data.size());
+            data.insert(pos, s);
+            start.insert(start.begin() + i, pos);
+            for (int j = i + 1; j < size(); ++j)
+                start[j] += (uint32_t)s.size();
+            return true;
+        }
+        void erase(string_view s) {
+            int i = rank(s);
+            if (i == size() || at(i) != s) return;
+            data.erase(start[i], s.size());
+            start.erase(start.begin() + i);
+            for (int j = i; j < size(); ++j)
+                start[j] -= (uint32_t)s.size();
+        }
+    };
+
+    class Node {
+        Node* child[256] {}; // next trie node for each byte
+        Bucket* bucket[256] {}; // or the bucket of suffixes after that byte
+        bool endOfWord {};
+        friend BurstTrie;
+    };
+
+    // replaces the bucket under cur's slot c by a trie node
+    void _burst(Node* cur, unsigned char c) {
+        Bucket* b = cur->bucket[c];
+        Node* node = new Node();
+        for (int i = 0; i < b->size(); ++i) {
+            string_view s = b->at(i);
+            if (s.empty()) {
+                node->endOfWord = true;
+                continue;
+            }
+            unsigned char d = (unsigned char)s[0];
+            if (node->bucket[d] == nullptr) node->bucket[d] = new Bucket();
+            Bucket* to = node->bucket[d];
+            to->start.push_back((uint32_t)to->data.size()); // already sorted, append
+            to->data.append(s.substr(1));
+        }
+        delete b;
+        cur->bucket[c] = nullptr;
+        cur->child[c] = node;
+
+        for (int d = 0; d < 256; ++d) // all suffixes may share their first byte
+            if (node->bucket[d] && node->bucket[d]->size() > limit)
+                _burst(node, (unsigned char)d);
+    }
+
+    void _traverse(Node* cur, string& prefix, const function<void(const string&)>& process) {
+        if (cur->endOfWord) process(prefix);
+        for (int c = 0; c < 256; ++c) {
+            prefix.push_back((char)c);
+            if (cur->child[c]) _traverse(cur->child[c], prefix, process);
+            else if (cur->bucket[c]) {
+                Bucket* b = cur->bucket[c];
+                for (int i = 0; i < b->size(); ++i)
+                    process(prefix + string(b->at(i)));
+            }
+            prefix.pop_back();
+        }
+    }
+
+    void _clear(Node* cur) {
+        for (int c = 0; c < 256; ++c) {
+            if (cur->child[c]) _clear(cur->child[c]);
+            delete cur->bucket[c];
+        }
+        delete cur;
+    }
+
+    Node* root {};
+    int limit {}; // most suffixes a bucket holds before bursting
+public:
+    explicit BurstTrie(int limit = 128) : root(new Node()), limit(limit) {}
+    ~BurstTrie() {
+        _clear(root);
+    }
+    BurstTrie(const BurstTrie&) = delete;
+    BurstTrie& operator=(const BurstTrie&) = delete;
+
+    void insert(const string& s) {
+        if (s.empty()) return;
+        Node* cur = root;
+        for (size_t i = 0; i < s.size(); ++i) {
+            unsigned char c = (unsigned char)s[i];
+            if (cur->child[c]) {
+                cur = cur->child[c];
+                continue;
+            }
+            if (cur->bucket[c] == nullptr) cur->bucket[c] = new Bucket();
+            if (cur->bucket[c]->insert(string_view(s).substr(i + 1)) && cur->bucket[c]->size() > limit)
+                _burst(cur, c);
+            return;
+        }
+        cur->endOfWord = true;
+    }
+    void erase(const string& s) {
+        if (s.empty()) return;
+        Node* cur = root;
+        for (size_t i = 0; i < s.size(); ++i) {
+            unsigned char c = (unsigned char)s[i];
+            if (cur->child[c]) {
+                cur = cur->child[c];
+                continue;
+            }
+            if (cur->bucket[c]) {
+                cur->bucket[c]->erase(string_view(s).substr(i + 1));
+                if (cur->bucket[c]->size() == 0) {
+                    delete cur->bucket[c];
+                    cur->bucket[c] = nullptr;
+                }
+            }
+            return;
+        }
+        cur->endOfWord = false;
+    }
+    bool search(const string& s) {
+        if (s.empty()) return false;
+        Node* cur = root;
+        for (size_t i = 0; i < s.size(); ++i) {
+            unsigned char c = (unsigned char)s[i];
+            if (cur->child[c]) {
+                cur = cur->child[c];
+                continue;
+            }
+            return cur->bucket[c] && cur->bucket[c]->contains(string_view(s).substr(i + 1));
+        }
+        return cur->endOfWord;
+    }
+    // visits every word in byte order
+    void traverse(function<void(const string&)> process) {
+        string prefix;
+        _traverse(root, prefix, process);
+    }
+    void clear() {
+        _clear(root);
+        root = new Node();
+    }
+};
+
+#endif //AED_TRIEB_BURSTTRIE_H
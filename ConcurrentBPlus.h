@@ -0,0 +1,499 @@
+#ifndef AED_TRIEB_CONCURRENTBPLUS_H
+#define AED_TRIEB_CONCURRENTBPLUS_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+using namespace std;
+
+// B+ tree with optimistic lock coupling. Every node carries a version
+// counter: readers never write shared memory, they only check that the
+// version did not move while they looked at the node, and retry otherwise.
+// Writers lock just the nodes they change (the leaf, or the parent and
+// children involved in a split, borrow or merge).
+//
+// Readers may look at a node while it is being written and then discard what
+// they saw, so keys must be trivially copyable, and the fields they look at
+// are atomics, which makes those reads well defined.
+//
+// Nodes unlinked by merges are reclaimed by epochs: every call pins the
+// current epoch while it runs, and a node unlinked in epoch e is freed once
+// no running call pinned e or an earlier one, as only those can still hold
+// a pointer to it. Unfreed nodes are thus bounded by about twice those
+// unlinked while the longest running call ran, plus 64.
+template<typename T>
+class ConcurrentBPlus {
+    static_assert(is_trivially_copyable<T>::value, "ConcurrentBPlus needs trivially copyable keys");
+
+    // A field readers may load while a writer stores to it. Stores release
+    // and loads acquire, as in a seqlock: a reader that sees a store made
+    // under a lock then sees the version moved when it checks it, and one
+    // that follows a child pointer sees the child as it was built. Both are
+    // plain moves on x86.
+    template<typename U>
+    class Shared {
+        atomic<U> v;
+
+    public:
+        Shared() : v() {}
+        operator U() const { return v.load(memory_order_acquire); }
+        Shared& operator=(U u) {
+            v.store(u, memory_order_release);
+            return *this;
+        }
+        Shared& operator=(const Shared& o) { return *this = (U)o; }
+        // only under the node's write lock, so no other writer interleaves
+        Shared& operator+=(U d) { return *this = (U)*this + d; }
+        Shared& operator-=(U d) { return *this = (U)*this - d; }
+    };
+
+    class Node {
+        atomic<uint64_t> version {0b100}; // bit 1: locked, bit 0: obsolete
+        Shared<int> n; // number of keys
+        Shared<T>* key {}; // array of keys
+        Shared<Node*>* c {}; // array of pointers to children
+        Shared<Node*> next; // right sibling, only used by leaves
+        bool leaf {}; // boolean, true if it is a leaf, set before the node is published
+        friend ConcurrentBPlus;
+
+    public:
+        explicit Node(int t) {
+            int m = (t<<1); // order of tree
+            n = 0;
+            leaf = true;
+            next = nullptr;
+
+            key = new Shared<T>[m - 1];
+
+            c = new Shared<Node*>[m];
+            for (int i = 0; i < m; ++i)
+                c[i] = nullptr;
+        }
+        ~Node() {
+            delete[] key;
+            delete[] c;
+        }
+    };
+
+    static bool is_locked(uint64_t v) { return (v & 0b10) == 0b10; }
+    static bool is_obsolete(uint64_t v) { return (v & 0b01) == 0b01; }
+
+    // waits until x is unlocked, fails if x has been unlinked from the tree
+    static bool read_lock(Node* x, uint64_t& v) {
+        v = x->version.load();
+        while (is_locked(v)) {
+            this_thread::yield();
+            v = x->version.load();
+        }
+        return !is_obsolete(v);
+    }
+
+    // true if nobody wrote x since v was read
+    static bool check(Node* x, uint64_t v) {
+        return x->version.load() == v;
+    }
+
+    static bool upgrade(Node* x, uint64_t v) {
+        return x->version.compare_exchange_strong(v, v + 0b10);
+    }
+
+    // used while other locks are held, so it never waits
+    static bool try_write_lock(Node* x) {
+        uint64_t v = x->version.load();
+        if (is_locked(v) || is_obsolete(v)) return false;
+        return upgrade(x, v);
+    }
+
+    static void write_unlock(Node* x) { x->version.fetch_add(0b10); }
+    static void write_unlock_obsolete(Node* x) { x->version.fetch_add(0b11); }
+
+    int max_keys() const { return (t<<1) - 1; }
+
+    // index of the child whose range holds k, n is clamped because a
+    // concurrent writer may leave it inconsistent until we validate
+    int child_index(Node* x, const T& k) const {
+        int n = min(max((int)x->n, 0), max_keys());
+        int i = 0;
+        for (; i < n; ++i)
+            if (k < x->key[i]) break;
+        return i;
+    }
+
+    // A slot per running call, holding the epoch it pinned (0 if free), on
+    // a cache line of its own
+    struct alignas(64) Slot {
+        atomic<uint64_t> pinned {0};
+    };
+
+    // Holds a slot for the length of a call. The epoch read may be stale by
+    // the time it is pinned, which only makes the pin more conservative.
+    class Pin {
+        Slot* slot {};
+
+    public:
+        explicit Pin(ConcurrentBPlus& tree) {
+            static thread_local size_t hint = hash<thread::id>()(this_thread::get_id());
+            size_t n = tree.slots.size();
+            for (;;) {
+                for (size_t j = 0; j < n; ++j) {
+                    Slot& s = tree.slots[(hint + j) % n];
+                    uint64_t free = 0;
+                    if (s.pinned.load(memory_order_relaxed) == 0 && s.pinned.compare_exchange_strong(free, tree.epoch.load())) {
+                        slot = &s;
+                        hint = (hint + j) % n;
+                        return;
+                    }
+                }
+                this_thread::yield(); // more calls running than slots
+            }
+        }
+        Pin(const Pin&) = delete;
+        Pin& operator=(const Pin&) = delete;
+        ~Pin() { slot->pinned.store(0); }
+    };
+
+    // x has been unlinked, it is freed once every call that may see it is done
+    void retire(Node* x) {
+        uint64_t e = epoch.fetch_add(1); // calls pinning from now on cannot reach x
+        lock_guard<mutex> guard(retired_mutex);
+        retired.push_back({x, e});
+        if (retired.size() >= reclaim_at) reclaim();
+    }
+
+    // frees the retired nodes no running call can hold, retired_mutex held
+    void reclaim() {
+        uint64_t oldest = UINT64_MAX;
+        for (Slot& s : slots) {
+            uint64_t p = s.pinned.load();
+            if (p != 0) oldest = min(oldest, p);
+        }
+        size_t kept = 0;
+        for (auto& [x, e] : retired) {
+            if (e < oldest) delete x;
+            else retired[kept++] = {x, e};
+        }
+        retired.resize(kept);
+        reclaim_at = max<size_t>(64, 2 * kept); // so pinned stragglers do not make every retire scan
+    }
+
+    // x and the full child x->c[i] are write locked
+    void split_children(Node* x, int i) {
+        Node* y = x->c[i];
+        Node* z = new Node(t);
+        z->leaf = y->leaf;
+
+        for (int j = x->n; j > i; --j) // shift keys right
+            x->key[j] = x->key[j - 1];
+        for (int j = x->n + 1; j > i + 1; --j) // shift children right
+            x->c[j] = x->c[j - 1];
+        x->n += 1;
+        x->c[i + 1] = z;
+
+        if (y->leaf) {
+            for (int j = t - 1; j < y->n; ++j) // z keeps y's greatest keys
+                z->key[j - (t - 1)] = y->key[j];
+            z->n = t;
+            y->n = t - 1;
+            x->key[i] = z->key[0]; // separator is copied up
+            z->next = y->next;
+            y->next = z;
+        }
+        else {
+            for (int j = 0; j < t - 1; ++j) // assign to z, y's greatest keys
+                z->key[j] = y->key[j + t];
+            for (int j = 0; j < t; ++j) // assign to z, y's greatest children
+                z->c[j] = y->c[j + t];
+            z->n = t - 1;
+            x->key[i] = y->key[t - 1]; // middle key moves up
+            y->n = t - 1;
+        }
+    }
+
+    // x->c[i] has t - 1 keys and x, x->c[i] and the sibling s are write locked.
+    // Moves one key from s, returns false if s has none to spare.
+    bool erase_3a(Node* x, int i, Node* s) {
+        if (s->n < t) return false;
+        Node* y = x->c[i];
+        if (i > 0 && s == x->c[i - 1]) { // borrow from left sibling
+            for (int j = y->n; j > 0; --j) // shift all keys right
+                y->key[j] = y->key[j - 1];
+            if (!y->leaf)
+                for (int j = y->n + 1; j > 0; --j) // shift all children right
+                    y->c[j] = y->c[j - 1];
+
+            if (y->leaf) {
+                y->key[0] = s->key[s->n - 1];
+                x->key[i - 1] = y->key[0];
+            }
+            else {
+                y->key[0] = x->key[i - 1];
+                y->c[0] = s->c[s->n];
+                x->key[i - 1] = s->key[s->n - 1];
+            }
+            y->n += 1;
+            s->n -= 1;
+        }
+        else { // borrow from right sibling
+            if (y->leaf) {
+                y->key[y->n] = s->key[0];
+                x->key[i] = s->key[1];
+            }
+            else {
+                y->key[y->n] = x->key[i];
+                y->c[y->n + 1] = s->c[0];
+                x->key[i] = s->key[0];
+            }
+            y->n += 1;
+
+            for (int j = 1; j < s->n; ++j) // shift keys left
+                s->key[j - 1] = s->key[j];
+            if (!s->leaf)
+                for (int j = 1; j <= s->n; ++j) // shift children left
+                    s->c[j - 1] = s->c[j];
+            s->n -= 1;
+        }
+        return true;
+    }
+
+    // merges x->c[i + 1] into x->c[i], returns the emptied right node
+    Node* erase_3b(Node* x, int i) {
+        Node* y = x->c[i];
+        Node* z = x->c[i + 1];
+
+        if (!y->leaf) {
+            y->key[y->n] = x->key[i]; // separator comes down
+            y->n += 1;
+        }
+        for (int j = 0; j < z->n; ++j) // pass keys to left child
+            y->key[y->n + j] = z->key[j];
+        if (!y->leaf)
+            for (int j = 0; j <= z->n; ++j) // pass children to left child
+                y->c[y->n + j] = z->c[j];
+        y->n += z->n;
+        if (y->leaf) y->next = z->next;
+
+        for (int j = i + 1; j < x->n; ++j) // shift x's keys left
+            x->key[j - 1] = x->key[j];
+        for (int j = i + 2; j <= x->n; ++j) // shift x's children left
+            x->c[j - 1] = x->c[j];
+        x->c[x->n] = nullptr;
+        x->n -= 1;
+        return z;
+    }
+
+    bool try_insert(const T& k) {
+        Node* x = root.load();
+        uint64_t v;
+        if (!read_lock(x, v) || x != root.load()) return false;
+
+        Node* p = nullptr;
+        uint64_t pv = 0;
+        int pi = 0;
+        while (true) {
+            if (x->n == max_keys()) {
+                if (p && !upgrade(p, pv)) return false;
+                if (!upgrade(x, v)) {
+                    if (p) write_unlock(p);
+                    return false;
+                }
+                if (p == nullptr) {
+                    if (x != root.load()) {
+                        write_unlock(x);
+                        return false;
+                    }
+                    Node* s = new Node(t); // unreachable until published
+                    s->leaf = false;
+                    s->c[0] = x;
+                    split_children(s, 0);
+                    root.store(s);
+                }
+                else {
+                    split_children(p, pi);
+                    write_unlock(p);
+                }
+                write_unlock(x);
+                return false;
+            }
+            if (p && !check(p, pv)) return false;
+            if (x->leaf) break;
+
+            int i = child_index(x, k);
+            Node* child = x->c[i];
+            if (!check(x, v)) return false;
+
+            p = x;
+            pv = v;
+            pi = i;
+            x = child;
+            if (!read_lock(x, v)) return false;
+        }
+
+        if (!upgrade(x, v)) return false;
+        int i = 0;
+        for (; i < x->n; ++i)
+            if (k <= x->key[i]) break;
+        if (i == x->n || !(x->key[i] == k)) {
+            for (int j = x->n; j > i; --j) // shift keys right
+                x->key[j] = x->key[j - 1];
+            x->key[i] = k;
+            x->n += 1;
+        }
+        write_unlock(x);
+        return true;
+    }
+
+    bool try_erase(const T& k) {
+        Node* x = root.load();
+        uint64_t v;
+        if (!read_lock(x, v) || x != root.load()) return false;
+
+        Node* p = nullptr;
+        uint64_t pv = 0;
+        int pi = 0;
+        while (true) {
+            if (p && x->n <= t - 1) { // refill x before going below it
+                if (!upgrade(p, pv)) return false;
+                if (!upgrade(x, v)) {
+                    write_unlock(p);
+                    return false;
+                }
+                int si = (pi > 0 ? pi - 1 : pi + 1);
+                Node* s = p->c[si];
+                if (!try_write_lock(s)) {
+                    write_unlock(x);
+                    write_unlock(p);
+                    return false;
+                }
+
+                if (erase_3a(p, pi, s)) {
+                    write_unlock(s);
+                    write_unlock(x);
+                }
+                else {
+                    Node* l = (si < pi ? s : x);
+                    Node* r = erase_3b(p, min(si, pi));
+                    write_unlock(l);
+                    write_unlock_obsolete(r);
+                    retire(r);
+                }
+
+                if (p->n == 0 && p == root.load()) {
+                    root.store(p->c[0]);
+                    write_unlock_obsolete(p);
+                    retire(p);
+                }
+                else write_unlock(p);
+                return false;
+            }
+            if (p && !check(p, pv)) return false;
+            if (x->leaf) break;
+
+            int i = child_index(x, k);
+            Node* child = x->c[i];
+            if (!check(x, v)) return false;
+
+            p = x;
+            pv = v;
+            pi = i;
+            x = child;
+            if (!read_lock(x, v)) return false;
+        }
+
+        if (!upgrade(x, v)) return false;
+        int i = 0;
+        for (; i < x->n; ++i)
+            if (k <= x->key[i]) break;
+        if (i < x->n && x->key[i] == k) {
+            for (int j = i + 1; j < x->n; ++j) // shift keys left
+                x->key[j - 1] = x->key[j];
+            x->n -= 1;
+        }
+        write_unlock(x);
+        return true;
+    }
+
+    bool try_search(const T& k, bool& found) {
+        Node* x = root.load();
+        uint64_t v;
+        if (!read_lock(x, v) || x != root.load()) return false;
+
+        while (!x->leaf) {
+            Node* child = x->c[child_index(x, k)];
+            if (!check(x, v)) return false;
+            uint64_t cv;
+            // x is checked again once child is locked, or a borrow between
+            // both could have moved k out of child unnoticed
+            if (!read_lock(child, cv) || !check(x, v)) return false;
+            x = child;
+            v = cv;
+        }
+
+        int n = min(max((int)x->n, 0), max_keys());
+        found = false;
+        for (int i = 0; i < n && !found; ++i)
+            found = (x->key[i] == k);
+        return check(x, v);
+    }
+
+    void clear(Node* x) {
+        if (!x->leaf)
+            for (int i = 0; i <= x->n; ++i)
+                clear(x->c[i]);
+        delete x;
+    }
+
+    int t {};
+    atomic<Node*> root {};
+    atomic<uint64_t> epoch {1};
+    vector<Slot> slots;
+    vector<pair<Node*, uint64_t>> retired; // unlinked nodes and their epoch, calls may still be looking at them
+    size_t reclaim_at = 64;
+    mutex retired_mutex;
+
+public:
+    explicit ConcurrentBPlus(int t) : t(t), root(new Node(t)), slots(max<size_t>(64, 4 * thread::hardware_concurrency())) {}
+    ~ConcurrentBPlus() {
+        clear(root.load());
+        for (auto& [x, e] : retired)
+            delete x;
+    }
+    ConcurrentBPlus(const ConcurrentBPlus&) = delete;
+    ConcurrentBPlus& operator=(const ConcurrentBPlus&) = delete;
+
+    void insert(T k) {
+        Pin pin (*this);
+        while (!try_insert(k));
+    }
+    void erase(T k) {
+        Pin pin (*this);
+        while (!try_erase(k));
+    }
+    bool search(T k) {
+        Pin pin (*this);
+        bool found = false;
+        while (!try_search(k, found));
+        return found;
+    }
+    // nodes unlinked but not freed yet, as calls that started before may
+    // still be reading them
+    size_t retired_nodes() {
+        lock_guard<mutex> guard(retired_mutex);
+        return retired.size();
+    }
+    // walks the leaf chain, only safe while no writer is running
+    void traverse(function<void(T)> process) {
+        Node* x = root.load();
+        while (!x->leaf) x = x->c[0];
+        for (; x != nullptr; x = x->next)
+            for (int i = 0; i < x->n; ++i)
+                process(x->key[i]);
+    }
+};
+
+#endif //AED_TRIEB_CONCURRENTBPLUS_H
@@ -0,0 +1,127 @@
+#ifndef AED_TRIEB_EXTERNALSORT_H
+#define AED_TRIEB_EXTERNALSORT_H
+
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+using namespace std;
+
+// Sorts a binary stream of T (native byte order) that may not fit in memory
+// and calls out(k) for every key in ascending order, duplicates included.
+// Runs of memory / sizeof(T) keys are sorted and written to temporary files,
+// then merged k at a time, k being as large as `memory` allows with a
+// buffer of at least 256 KiB per run. More runs than that take extra passes.
+template<typename T, typename Out>
+void external_sort(istream& in, size_t memory, Out out) {
+    static_assert(is_trivially_copyable<T>::value, "keys are read and written as raw bytes");
+    const size_t block = 256 << 10; // smallest read buffer per run
+    memory = max(memory, 4 * block);
+
+    // run files are closed, and so deleted, however the sort ends
+    using File = unique_ptr<FILE, decltype(&fclose)>;
+
+    struct Run {
+        FILE* f; // owned by a File of the caller
+        vector<T> buf;
+        size_t pos {}, len {};
+
+        bool next(T& k) {
+            if (pos == len) {
+                len = fread(buf.data(), sizeof(T), buf.size(), f);
+                pos = 0;
+                if (ferror(f)) throw runtime_error("external_sort: cannot read a run file");
+                if (len == 0) return false;
+            }
+            k = buf[pos++];
+            return true;
+        }
+    };
+
+    auto create = []() {
+        File f (tmpfile(), &fclose);
+        if (f == nullptr) throw runtime_error("external_sort: cannot create a run file");
+        return f;
+    };
+
+    // a full disk must not cut a run short unnoticed
+    auto write = [](FILE* f, const T* keys, size_t n) {
+        if (fwrite(keys, sizeof(T), n, f) != n) throw runtime_error("external_sort: cannot write a run file");
+    };
+
+    // merges the files in [first, last) (closing them) into emit
+    auto merge = [&](File* first, File* last, auto emit) {
+        size_t keys = max<size_t>(1, memory / sizeof(T) / (size_t)(last - first + 1));
+        vector<Run> runs;
+        for (File* f = first; f != last; ++f) {
+            if (fflush(f->get()) != 0 || ferror(f->get())) throw runtime_error("external_sort: cannot write a run file");
+            rewind(f->get());
+            runs.push_back({f->get(), vector<T>(keys)});
+        }
+
+        using Head = pair<T, size_t>;
+        auto later = [](const Head& a, const Head& b) { return b.first < a.first; };
+        priority_queue<Head, vector<Head>, decltype(later)> heap(later);
+        T k;
+        for (size_t i = 0; i < runs.size(); ++i)
+            if (runs[i].next(k)) heap.push({k, i});
+        while (!heap.empty()) {
+            auto [key, i] = heap.top();
+            heap.pop();
+            emit(key);
+            if (runs[i].next(k)) heap.push({k, i});
+        }
+        for (File* f = first; f != last; ++f) f->reset();
+    };
+
+    // run generation
+    vector<File> files;
+    {
+        vector<T> chunk(memory / sizeof(T));
+        while (in) {
+            in.read((char*)chunk.data(), (streamsize)(chunk.size() * sizeof(T)));
+            if ((size_t)in.gcount() % sizeof(T) != 0) throw runtime_error("external_sort: input ends in a partial key");
+            size_t got = (size_t)in.gcount() / sizeof(T);
+            if (got == 0) break;
+            sort(chunk.begin(), chunk.begin() + got);
+            if (files.empty() && !in) { // it all fit, no need for disk
+                for (size_t i = 0; i < got; ++i) out(chunk[i]);
+                return;
+            }
+            files.push_back(create());
+            write(files.back().get(), chunk.data(), got);
+        }
+    }
+
+    // merge passes until one pass can take every run
+    size_t fan_in = max<size_t>(2, memory / block - 1);
+    while (files.size() > fan_in) {
+        vector<File> merged;
+        for (size_t i = 0; i < files.size(); i += fan_in) {
+            size_t j = min(files.size(), i + fan_in);
+            File run = create();
+            FILE* f = run.get();
+            vector<T> buf;
+            buf.reserve(block / sizeof(T) + 1);
+            merge(files.data() + i, files.data() + j, [&](const T& k) {
+                buf.push_back(k);
+                if (buf.size() * sizeof(T) >= block) {
+                    write(f, buf.data(), buf.size());
+                    buf.clear();
+                }
+            });
+            write(f, buf.data(), buf.size());
+            merged.push_back(move(run));
+        }
+        files.swap(merged);
+    }
+    merge(files.data(), files.data() + files.size(), out);
+}
+
+#endif //AED_TRIEB_EXTERNALSORT_H
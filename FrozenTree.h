@@ -0,0 +1,114 @@
+#ifndef AED_TRIEB_FROZENTREE_H
+#define AED_TRIEB_FROZENTREE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+using namespace std;
+
+// Read-only search tree over a sorted array (a static B+ tree, or S+tree).
+// There are no pointers: every node is 16 keys in one cache line (for 32-bit
+// keys) and the children of node j in a layer are nodes j * 17 to j * 17 + 16
+// of the layer below. Key l of a node is the smallest key under child l + 1.
+// The bottom layer is the sorted keys themselves, padded to whole nodes, so
+// a search ends with a pointer into it and range iteration just walks it.
+template<typename T>
+class FrozenTree {
+    static_assert(is_arithmetic<T>::value, "FrozenTree pads nodes with the largest key");
+    static constexpr int B = 16; // keys per node
+
+    vector<T> storage; // every layer, top first, with room to align
+    T* base {}; // storage aligned to a cache line
+    vector<size_t> offset; // where each layer starts, bottom first
+    size_t n {};
+
+    // number of keys in the node at p smaller than k
+    static int rank(const T* p, T k) {
+#ifdef __SSE2__
+        if constexpr (is_integral<T>::value && sizeof(T) == 4) {
+            // SSE2 only has signed compares, flip the sign bit of unsigned keys
+            const int flip = (is_signed<T>::value ? 0 : (int)0x80000000);
+            __m128i v = _mm_set1_epi32((int)k ^ flip), f = _mm_set1_epi32(flip);
+            const __m128i* q = (const __m128i*)p;
+            __m128i c0 = _mm_cmpgt_epi32(v, _mm_xor_si128(_mm_load_si128(q), f));
+            __m128i c1 = _mm_cmpgt_epi32(v, _mm_xor_si128(_mm_load_si128(q + 1), f));
+            __m128i c2 = _mm_cmpgt_epi32(v, _mm_xor_si128(_mm_load_si128(q + 2), f));
+            __m128i c3 = _mm_cmpgt_epi32(v, _mm_xor_si128(_mm_load_si128(q + 3), f));
+            // one bit per key, keys are sorted so the set bits are a prefix
+            int mask = _mm_movemask_epi8(_mm_packs_epi16(_mm_packs_epi32(c0, c1), _mm_packs_epi32(c2, c3)));
+            return __builtin_ctz(~mask);
+        }
+#endif
+        int r = 0;
+        for (int i = 0; i < B; ++i)
+            r += (p[i] < k);
+        return r;
+    }
+
+public:
+    FrozenTree() = default;
+    FrozenTree(const FrozenTree&) = delete;
+    FrozenTree& operator=(const FrozenTree&) = delete;
+    FrozenTree(FrozenTree&&) = default;
+    FrozenTree& operator=(FrozenTree&&) = default;
+
+    // keys must be sorted
+    explicit FrozenTree(const vector<T>& keys) : n(keys.size()) {
+        if (n == 0) return;
+        vector<size_t> nodes = {(n + B - 1) / B}; // per layer, bottom first
+        while (nodes.back() > 1)
+            nodes.push_back((nodes.back() + B) / (B + 1));
+
+        size_t total = 0;
+        offset.resize(nodes.size());
+        for (size_t h = nodes.size(); h-- > 0;) {
+            offset[h] = total;
+            total += nodes[h] * B;
+        }
+        size_t pad = 64 / sizeof(T) + 1;
+        storage.assign(total + pad, numeric_limits<T>::max());
+        base = storage.data();
+        while ((uintptr_t)base % 64 != 0 && base < storage.data() + pad - 1) ++base;
+
+        T* leaves = base + offset[0];
+        for (size_t i = 0; i < n; ++i)
+            leaves[i] = keys[i];
+
+        size_t span = 1; // leaf nodes under a node of the layer below
+        for (size_t h = 1; h < nodes.size(); ++h) {
+            T* layer = base + offset[h];
+            for (size_t j = 0; j < nodes[h]; ++j)
+                for (int l = 0; l < B; ++l) {
+                    size_t first = (j * (B + 1) + l + 1) * span * B; // smallest key under child l + 1
+                    if (first < n) layer[j * B + l] = keys[first];
+                }
+            span *= B + 1;
+        }
+    }
+
+    size_t size() const { return n; }
+    const T* begin() const { return base + (offset.empty() ? 0 : offset[0]); }
+    const T* end() const { return begin() + n; }
+
+    // first key >= k, or end()
+    const T* lower_bound(T k) const {
+        if (n == 0) return end();
+        size_t j = 0;
+        for (size_t h = offset.size() - 1; h > 0; --h)
+            j = j * (B + 1) + rank(base + offset[h] + j * B, k);
+        size_t i = j * B + rank(base + offset[0] + j * B, k);
+        return begin() + (i < n ? i : n);
+    }
+
+    bool search(T k) const {
+        const T* p = lower_bound(k);
+        return p != end() && *p == k;
+    }
+};
+
+#endif //AED_TRIEB_FROZENTREE_H
@@ -0,0 +1,189 @@
+#ifndef AED_TRIEB_MULTIBITTRIE_H
+#define AED_TRIEB_MULTIBITTRIE_H
+
+#include <string>
+#include <vector>
+using namespace std;
+
+// Longest-prefix-match table from bit-string prefixes (IPv4 or IPv6 routes,
+// or byte strings such as URL paths) to values. It is a multibit trie of
+// stride 8: every node is an array of 256 slots indexed by one byte of the
+// key. A prefix that ends partway through a byte is expanded over every slot
+// it covers in the node of that byte, where the longer of two overlapping
+// prefixes wins the slot. A lookup reads one slot per key byte and keeps the
+// last match, so an IPv4 address costs at most 4 memory accesses.
+template<typename V>
+class MultibitTrie {
+    struct Node;
+    struct Slot {
+        Node* child {};
+        int route = -1; // longest prefix ending in this node that covers the slot
+    };
+    struct Node {
+        Slot slot[256];
+        vector<int> own; // routes ending in this node
+        int children {};
+    };
+    struct Route {
+        V value;
+        int bits; // prefix bits within the node's byte, 1 to 8
+        int head; // those bits, left aligned in the byte
+    };
+
+    Node* root {};
+    vector<Route> routes;
+    vector<int> unused; // free entries of routes
+    int fallback = -1; // the empty prefix, matching every key
+    size_t count {};
+
+    static int mask(int bits) { return (0xFF << (8 - bits)) & 0xFF; }
+
+    int add_route(const V& value, int bits, int head) {
+        if (unused.empty()) {
+            routes.push_back({value, bits, head});
+            return (int)routes.size() - 1;
+        }
+        int j = unused.back();
+        unused.pop_back();
+        routes[j] = {value, bits, head};
+        return j;
+    }
+
+    void _clear(Node* x) {
+        if (x == nullptr) return;
+        for (Slot& s : x->slot)
+            _clear(s.child);
+        delete x;
+    }
+
+public:
+    MultibitTrie() = default;
+    MultibitTrie(const MultibitTrie&) = delete;
+    MultibitTrie& operator=(const MultibitTrie&) = delete;
+    ~MultibitTrie() {
+        clear();
+    }
+
+    // maps the first `bits` bits of prefix to value, replacing any value it had
+    void insert(const unsigned char* prefix, int bits, const V& value) {
+        if (bits == 0) {
+            if (fallback < 0) {
+                fallback = add_route(value, 0, 0);
+                count += 1;
+            }
+            else routes[fallback].value = value;
+            return;
+        }
+        if (root == nullptr) root = new Node();
+        Node* x = root;
+        int d = (bits - 1) / 8; // bytes before the last one
+        for (int i = 0; i < d; ++i) {
+            Slot& s = x->slot[prefix[i]];
+            if (s.child == nullptr) {
+                s.child = new Node();
+                x->children += 1;
+            }
+            x = s.child;
+        }
+
+        int r = bits - 8 * d, head = prefix[d] & mask(r);
+        for (int j : x->own)
+            if (routes[j].bits == r && routes[j].head == head) {
+                routes[j].value = value;
+                return;
+            }
+        int j = add_route(value, r, head);
+        x->own.push_back(j);
+        count += 1;
+        for (int b = head; b < head + (1 << (8 - r)); ++b) {
+            int& cur = x->slot[b].route;
+            if (cur < 0 || routes[cur].bits < r) cur = j;
+        }
+    }
+    void insert(const string& prefix, const V& value) {
+        insert((const unsigned char*)prefix.data(), 8 * (int)prefix.size(), value);
+    }
+
+    // removes the first `bits` bits of prefix, returns whether it was there
+    bool erase(const unsigned char* prefix, int bits) {
+        if (bits == 0) {
+            if (fallback < 0) return false;
+            unused.push_back(fallback);
+            fallback = -1;
+            count -= 1;
+            return true;
+        }
+        int d = (bits - 1) / 8;
+        vector<Slot*> path; // slots leading to the node of the last byte
+        Node* x = root;
+        for (int i = 0; i < d && x != nullptr; ++i) {
+            path.push_back(&x->slot[prefix[i]]);
+            x = x->slot[prefix[i]].child;
+        }
+        if (x == nullptr) return false;
+
+        int r = bits - 8 * d, head = prefix[d] & mask(r);
+        int k = 0;
+        while (k < (int)x->own.size() && !(routes[x->own[k]].bits == r && routes[x->own[k]].head == head)) ++k;
+        if (k == (int)x->own.size()) return false;
+        int j = x->own[k];
+        x->own.erase(x->own.begin() + k);
+        unused.push_back(j);
+        count -= 1;
+
+        // the slots it had go to the longest shorter prefix covering them
+        for (int b = head; b < head + (1 << (8 - r)); ++b) {
+            if (x->slot[b].route != j) continue;
+            int best = -1;
+            for (int o : x->own)
+                if ((b & mask(routes[o].bits)) == routes[o].head && (best < 0 || routes[o].bits > routes[best].bits))
+                    best = o;
+            x->slot[b].route = best;
+        }
+
+        // free nodes left with neither routes nor children, bottom up
+        for (int i = d - 1; i >= 0 && x->own.empty() && x->children == 0; --i) {
+            delete x;
+            path[i]->child = nullptr;
+            x = (i > 0 ? path[i - 1]->child : root);
+            x->children -= 1;
+        }
+        if (x == root && root->own.empty() && root->children == 0) {
+            delete root;
+            root = nullptr;
+        }
+        return true;
+    }
+    bool erase(const string& prefix) {
+        return erase((const unsigned char*)prefix.data(), 8 * (int)prefix.size());
+    }
+
+    // value of the longest prefix of key, or null if no prefix matches.
+    // It stays valid until the next insert or erase.
+    const V* match(const unsigned char* key, size_t bytes) const {
+        const V* best = (fallback >= 0 ? &routes[fallback].value : nullptr);
+        Node* x = root;
+        for (size_t i = 0; x != nullptr && i < bytes; ++i) {
+            const Slot& s = x->slot[key[i]];
+            if (s.route >= 0) best = &routes[s.route].value;
+            x = s.child;
+        }
+        return best;
+    }
+    const V* match(const string& key) const {
+        return match((const unsigned char*)key.data(), key.size());
+    }
+
+    size_t size() const { return count; }
+
+    void clear() {
+        _clear(root);
+        root = nullptr;
+        routes.clear();
+        unused.clear();
+        fallback = -1;
+        count = 0;
+    }
+};
+
+#endif //AED_TRIEB_MULTIBITTRIE_H
@@ -0,0 +1,340 @@
+#ifndef AED_TRIEB_PACKEDBPLUS_H
+#define AED_TRIEB_PACKEDBPLUS_H
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <type_traits>
+#include <vector>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+using namespace std;
+
+// B+ tree over integer keys whose leaves are frame-of-reference encoded:
+// a leaf keeps its smallest key and stores every key as an offset from it,
+// using 1, 2, 4 or 8 bytes per offset, whatever the leaf's range needs.
+// Clustered ids usually fit in 1 or 2 bytes instead of 8. Searching a leaf
+// compares the packed offsets directly, 4 to 16 at a time with SSE2.
+//
+// Leaves are re-encoded on every change, so this suits read-mostly indexes.
+template<typename T>
+class PackedBPlus {
+    static_assert(is_integral<T>::value, "PackedBPlus packs integer keys");
+    using U = typename make_unsigned<T>::type;
+
+    class Node {
+        int n {}; // number of keys
+        T* key {}; // array of separators, internal nodes only
+        Node** c {}; // array of pointers to children, internal nodes only
+        Node* next {}; // right sibling, leaves only
+        T base {}; // smallest key, leaves only
+        int w {}; // bytes per packed offset, leaves only
+        uint8_t* data {}; // n offsets from base, w bytes each, leaves only
+        bool leaf {}; // boolean, true if it is a leaf
+        friend PackedBPlus;
+
+    public:
+        Node(int t, bool leaf) : leaf(leaf) {
+            if (leaf) return;
+            int m = (t<<1); // order of tree
+            key = new T[m - 1];
+            c = new Node*[m];
+            for (int i = 0; i < m; ++i)
+                c[i] = nullptr;
+        }
+        ~Node() {
+            delete[] key;
+            delete[] c;
+            delete[] data;
+        }
+    };
+
+    static uint64_t offset(const Node* x, int i) {
+        const uint8_t* p = x->data + (size_t)i * x->w;
+        switch (x->w) {
+            case 1: return *p;
+            case 2: { uint16_t v; memcpy(&v, p, 2); return v; }
+            case 4: { uint32_t v; memcpy(&v, p, 4); return v; }
+            default: { uint64_t v; memcpy(&v, p, 8); return v; }
+        }
+    }
+
+    static T get(const Node* x, int i) { return (T)(U)((U)x->base + offset(x, i)); }
+
+    static vector<T> decode(const Node* x) {
+        vector<T> keys(x->n);
+        for (int i = 0; i < x->n; ++i)
+            keys[i] = get(x, i);
+        return keys;
+    }
+
+    // packs keys[first, last) into leaf x
+    static void encode(Node* x, const T* first, const T* last) {
+        x->n = (int)(last - first);
+        x->base = (x->n > 0 ? *first : T());
+        uint64_t range = (x->n > 0 ? (uint64_t)((U)last[-1] - (U)x->base) : 0);
+        x->w = (range <= 0xFF ? 1 : range <= 0xFFFF ? 2 : range <= 0xFFFFFFFFull ? 4 : 8);
+
+        delete[] x->data;
+        x->data = new uint8_t[(size_t)x->n * x->w];
+        for (int i = 0; i < x->n; ++i) {
+            uint64_t v = (U)first[i] - (U)x->base;
+            uint8_t* p = x->data + (size_t)i * x->w;
+            switch (x->w) {
+                case 1: *p = (uint8_t)v; break;
+                case 2: { uint16_t u = (uint16_t)v; memcpy(p, &u, 2); break; }
+                case 4: { uint32_t u = (uint32_t)v; memcpy(p, &u, 4); break; }
+                default: memcpy(p, &v, 8);
+            }
+        }
+    }
+    static void encode(Node* x, const vector<T>& keys) { encode(x, keys.data(), keys.data() + keys.size()); }
+
+    // number of keys in leaf x smaller than k
+    static int rank(const Node* x, T k) {
+        if (x->n == 0 || k <= x->base) return 0;
+        uint64_t off = (U)k - (U)x->base;
+        if (x->w != 8 && (off >> (x->w * 8)) != 0) return x->n;
+
+        int i = 0, r = 0;
+#ifdef __SSE2__
+        // SSE2 only has signed compares, flip the sign bit of both sides
+        const __m128i* p = (const __m128i*)x->data;
+        if (x->w == 1) {
+            __m128i flip = _mm_set1_epi8((char)0x80), v = _mm_set1_epi8((char)(off ^ 0x80));
+            for (; i + 16 <= x->n; i += 16, ++p)
+                r += __builtin_popcount(_mm_movemask_epi8(_mm_cmplt_epi8(_mm_xor_si128(_mm_loadu_si128(p), flip), v)));
+        }
+        else if (x->w == 2) {
+            __m128i flip = _mm_set1_epi16((short)0x8000), v = _mm_set1_epi16((short)(off ^ 0x8000));
+            for (; i + 8 <= x->n; i += 8, ++p)
+                r += __builtin_popcount(_mm_movemask_epi8(_mm_cmplt_epi16(_mm_xor_si128(_mm_loadu_si128(p), flip), v))) >> 1;
+        }
+        else if (x->w == 4) {
+            __m128i flip = _mm_set1_epi32((int)0x80000000), v = _mm_set1_epi32((int)(off ^ 0x80000000));
+            for (; i + 4 <= x->n; i += 4, ++p)
+                r += __builtin_popcount(_mm_movemask_epi8(_mm_cmplt_epi32(_mm_xor_si128(_mm_loadu_si128(p), flip), v))) >> 2;
+        }
+#endif
+        for (; i < x->n; ++i)
+            r += (offset(x, i) < off);
+        return r;
+    }
+
+    // index of the child whose range holds k
+    static int find(const Node* x, T k) {
+        int i = 0;
+        for (; i < x->n; ++i)
+            if (k < x->key[i]) break;
+        return i;
+    }
+
+    void split_children(Node* x, int i) {
+        for (int j = x->n; j > i; --j) // shift keys right
+            x->key[j] = x->key[j - 1];
+
+        x->n += 1; // increase key count
+
+        for (int j = x->n; j > i + 1; --j) // shift children right
+            x->c[j] = x->c[j - 1];
+
+        Node* y = x->c[i];
+        Node* z = new Node(t, y->leaf);
+
+        if (y->leaf) {
+            vector<T> keys = decode(y);
+            encode(y, keys.data(), keys.data() + t - 1);
+            encode(z, keys.data() + t - 1, keys.data() + keys.size());
+            x->key[i] = z->base; // copy a separator up
+            z->next = y->next;
+            y->next = z;
+        }
+        else {
+            int m = t - 1; // median of child's keys' array
+            for (int j = 0; j < m; ++j) // assign to z, y's greatest keys
+                z->key[j] = y->key[j + t];
+
+            for (int j = 0; j <= m; ++j) // assign to z, y's greatest children
+                z->c[j] = y->c[j + t];
+
+            x->key[i] = y->key[m]; // move middle key to x
+            z->n = t - 1;
+            y->n = t - 1;
+        }
+        x->c[i + 1] = z; // insert child in x
+    }
+
+    void insert_non_full(Node* x, T k) {
+        if (x->leaf) {
+            int i = rank(x, k);
+            if (i < x->n && get(x, i) == k) return;
+
+            vector<T> keys = decode(x);
+            keys.insert(keys.begin() + i, k);
+            encode(x, keys);
+            return;
+        }
+
+        int i = find(x, k);
+        if (x->c[i]->n == (t<<1) - 1) {
+            split_children(x, i);
+            return insert_non_full(x, k);
+        }
+        return insert_non_full(x->c[i], k);
+    }
+
+    // x->c[i] has t - 1 keys, borrow one from sibling z
+    void erase_3a(Node* x, int i, Node* z) {
+        Node* y = x->c[i];
+        bool left = (i > 0 && z == x->c[i - 1]);
+        if (y->leaf) {
+            vector<T> a = decode(y), b = decode(z);
+            if (left) {
+                a.insert(a.begin(), b.back());
+                b.pop_back();
+                x->key[i - 1] = a.front();
+            }
+            else {
+                a.push_back(b.front());
+                b.erase(b.begin());
+                x->key[i] = b.front();
+            }
+            encode(y, a);
+            encode(z, b);
+        }
+        else if (left) {
+            for (int j = y->n; j > 0; --j) // shift all keys right
+                y->key[j] = y->key[j - 1];
+            for (int j = y->n + 1; j > 0; --j) // shift all children right
+                y->c[j] = y->c[j - 1];
+            y->key[0] = x->key[i - 1]; // add key to y
+            y->c[0] = z->c[z->n]; // add child to y
+            x->key[i - 1] = z->key[z->n - 1];
+            z->c[z->n] = nullptr;
+            y->n += 1;
+            z->n -= 1;
+        }
+        else {
+            y->key[y->n] = x->key[i]; // add key to y
+            y->n += 1;
+            y->c[y->n] = z->c[0]; // add child to y
+            x->key[i] = z->key[0];
+            for (int j = 1; j < z->n; ++j)
+                z->key[j - 1] = z->key[j];
+            for (int j = 1; j <= z->n; ++j)
+                z->c[j - 1] = z->c[j];
+            z->c[z->n] = nullptr;
+            z->n -= 1;
+        }
+    }
+
+    // merges x->c[i + 1] into x->c[i]
+    void erase_3b(Node* x, int i) {
+        Node* y = x->c[i];
+        Node* z = x->c[i + 1];
+
+        if (y->leaf) {
+            vector<T> a = decode(y), b = decode(z);
+            a.insert(a.end(), b.begin(), b.end());
+            encode(y, a);
+            y->next = z->next;
+        }
+        else {
+            y->key[y->n] = x->key[i]; // add median key to y
+            y->n += 1;
+            for (int j = 0; j < z->n; ++j) // receive keys from right child
+                y->key[j + y->n] = z->key[j];
+            for (int j = 0; j <= z->n; ++j) // receive children from right child
+                y->c[j + y->n] = z->c[j];
+            y->n += z->n;
+        }
+
+        for (int j = i + 1; j < x->n; ++j) // shift x's keys left
+            x->key[j - 1] = x->key[j];
+        for (int j = i + 2; j <= x->n; ++j) // shift x's children left
+            x->c[j - 1] = x->c[j];
+        x->c[x->n] = nullptr;
+        x->n -= 1;
+
+        delete z;
+    }
+
+    // makes sure x->c[i] has at least t keys before descending into it
+    void erase_3(Node* x, int i) {
+        if (i > 0 && x->c[i - 1]->n >= t) return erase_3a(x, i, x->c[i - 1]);
+        if (i < x->n && x->c[i + 1]->n >= t) return erase_3a(x, i, x->c[i + 1]);
+        return erase_3b(x, (i < x->n ? i : i - 1));
+    }
+
+    void erase(Node* x, T k) {
+        if (x->leaf) {
+            int i = rank(x, k);
+            if (i == x->n || get(x, i) != k) return;
+
+            vector<T> keys = decode(x);
+            keys.erase(keys.begin() + i);
+            encode(x, keys);
+            return;
+        }
+
+        int i = find(x, k);
+        if (x->c[i]->n >= t) return erase(x->c[i], k);
+        erase_3(x, i);
+        return erase(x, k);
+    }
+
+    void clear(Node* x) {
+        if (!x->leaf)
+            for (int i = 0; i <= x->n; ++i)
+                clear(x->c[i]);
+        delete x;
+    }
+
+    int t {};
+    Node* root {};
+
+public:
+    explicit PackedBPlus(int t) : t(t) {}
+    ~PackedBPlus() { clear(); }
+    void clear() {
+        if (root != nullptr) clear(root);
+        root = nullptr;
+    }
+    void insert(T k) {
+        if (root == nullptr) root = new Node(t, true);
+        if (root->n == (t<<1) - 1) {
+            Node* s = new Node(t, false);
+            s->c[0] = root;
+            root = s;
+            split_children(s, 0);
+        }
+        insert_non_full(root, k);
+    }
+    void erase(T k) {
+        if (root == nullptr) return;
+        erase(root, k);
+        if (root->n == 0) {
+            Node* temp = root;
+            root = (root->leaf ? nullptr : root->c[0]);
+            delete temp;
+        }
+    }
+    bool search(T k) {
+        if (root == nullptr) return false;
+        Node* x = root;
+        while (!x->leaf) x = x->c[find(x, k)];
+        int i = rank(x, k);
+        return i < x->n && get(x, i) == k;
+    }
+    void traverse(function<void(T)> process) {
+        if (root == nullptr) return;
+        Node* x = root;
+        while (!x->leaf) x = x->c[0];
+        for (; x != nullptr; x = x->next)
+            for (int i = 0; i < x->n; ++i)
+                process(get(x, i));
+    }
+};
+
+#endif //AED_TRIEB_PACKEDBPLUS_H
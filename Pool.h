@@ -0,0 +1,158 @@
+#ifndef AED_TRIEB_POOL_H
+#define AED_TRIEB_POOL_H
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <vector>
+using namespace std;
+
+// Size-class pool behind PoolAllocator. Requests up to 64 KiB are rounded up
+// to a class (powers of two from 16 bytes and the halfway points between
+// them) and recycled through free lists. Every thread keeps its own lists,
+// so allocating and freeing take no lock; a thread trades a batch of blocks
+// with the shared lists only when one of its own runs dry or grows too
+// long. Blocks are carved from chunks that are kept until the program ends.
+class NodePool {
+    struct Free {
+        Free* next;
+    };
+
+    static constexpr int classes = 25; // 16 bytes to 64 KiB
+    static constexpr size_t largest = size_t(16) << 12;
+
+    // 16, 24, 32, 48, 64, 96, ...
+    static size_t size_of(int c) {
+        size_t p = size_t(16) << (c >> 1);
+        return (c & 1) ? p + p / 2 : p;
+    }
+
+    static int class_of(size_t bytes) {
+        if (bytes <= 16) return 0;
+        int k = 63 - __builtin_clzll(bytes - 1); // 2^k < bytes <= 2^(k+1)
+        size_t p = size_t(1) << k;
+        return 2 * (k - 4) + (bytes <= p + p / 2 ? 1 : 2);
+    }
+
+    // blocks moved at once between a thread and the shared lists
+    static size_t batch(int c) { return max<size_t>(4, (16 << 10) / size_of(c)); }
+
+    struct Cache {
+        Free* head[classes] {};
+        size_t count[classes] {};
+        ~Cache() { // a thread that ends hands its blocks back
+            for (int c = 0; c < classes; ++c)
+                if (head[c] != nullptr) instance().give(c, head[c]);
+        }
+    };
+
+    mutex lock;
+    Free* shared[classes] {};
+    vector<void*> chunks;
+
+    static NodePool& instance() {
+        static NodePool* pool = new NodePool(); // never destroyed, threads may outlive statics
+        return *pool;
+    }
+
+    static Cache& cache() {
+        thread_local Cache local;
+        return local;
+    }
+
+    // fills the empty list of class c in local
+    void take(int c, Cache& local) {
+        size_t size = size_of(c), n = batch(c);
+        lock_guard<mutex> guard(lock);
+        if (shared[c] == nullptr) {
+            char* chunk = (char*)::operator new(size * n);
+            chunks.push_back(chunk);
+            for (size_t i = 0; i < n; ++i) {
+                Free* f = (Free*)(chunk + i * size);
+                f->next = shared[c];
+                shared[c] = f;
+            }
+        }
+        Free* last = shared[c];
+        size_t taken = 1;
+        for (; taken < n && last->next != nullptr; ++taken)
+            last = last->next;
+        local.head[c] = shared[c];
+        local.count[c] = taken;
+        shared[c] = last->next;
+        last->next = nullptr;
+    }
+
+    // returns the list starting at first to the shared list of class c
+    void give(int c, Free* first) {
+        Free* last = first;
+        while (last->next != nullptr) last = last->next;
+        lock_guard<mutex> guard(lock);
+        last->next = shared[c];
+        shared[c] = first;
+    }
+
+public:
+    static void* allocate(size_t bytes) {
+        if (bytes > largest) return ::operator new(bytes);
+        int c = class_of(bytes);
+        Cache& local = cache();
+        if (local.head[c] == nullptr) instance().take(c, local);
+        Free* f = local.head[c];
+        local.head[c] = f->next;
+        local.count[c] -= 1;
+        return f;
+    }
+
+    static void deallocate(void* p, size_t bytes) {
+        if (bytes > largest) return ::operator delete(p);
+        int c = class_of(bytes);
+        Cache& local = cache();
+        Free* f = (Free*)p;
+        f->next = local.head[c];
+        local.head[c] = f;
+        local.count[c] += 1;
+        if (local.count[c] <= 2 * batch(c)) return;
+
+        Free* last = f; // keep a batch, give the rest back
+        for (size_t i = 1; i < batch(c); ++i)
+            last = last->next;
+        Free* rest = last->next;
+        last->next = nullptr;
+        local.count[c] = batch(c);
+        instance().give(c, rest);
+    }
+};
+
+// Standard allocator over NodePool, for the Alloc parameter of BTree and
+// BPlus. It is stateless, any instance frees what another allocated.
+template<typename T>
+struct PoolAllocator {
+    using value_type = T;
+
+    PoolAllocator() = default;
+    template<typename U>
+    PoolAllocator(const PoolAllocator<U>&) {}
+
+    T* allocate(size_t n) { return (T*)NodePool::allocate(n * sizeof(T)); }
+    void deallocate(T* p, size_t n) { NodePool::deallocate(p, n * sizeof(T)); }
+
+    template<typename U>
+    bool operator==(const PoolAllocator<U>&) const { return true; }
+    template<typename U>
+    bool operator!=(const PoolAllocator<U>&) const { return false; }
+};
+
+// Whether several threads may allocate through one instance of A at once,
+// which lets BPlus::build allocate from its threads. Assumed not, as for a
+// std::pmr::monotonic_buffer_resource; specialize it for others that may.
+template<typename A>
+struct thread_safe_allocator : false_type {};
+template<typename T>
+struct thread_safe_allocator<allocator<T>> : true_type {};
+template<typename T>
+struct thread_safe_allocator<PoolAllocator<T>> : true_type {};
+
+#endif //AED_TRIEB_POOL_H
@@ -0,0 +1,221 @@
+#ifndef AED_TRIEB_SNAPSHOTBPLUS_H
+#define AED_TRIEB_SNAPSHOTBPLUS_H
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+using namespace std;
+
+// B+ tree whose nodes are never modified once published. Writers copy the
+// root-to-leaf path they change (plus the sibling a borrow or merge touches)
+// and then swap the root, so a snapshot() taken by a reader keeps seeing the
+// same tree for as long as it is held. Nodes are reference counted and go
+// away with the last version that uses them.
+//
+// Writers are serialized among themselves but never wait for readers, and
+// readers never wait for writers. Leaves are not linked: a sibling pointer
+// would force copying the whole leaf level on every write.
+template<typename T>
+class SnapshotBPlus {
+    class Node {
+        vector<T> key; // array of keys
+        vector<shared_ptr<const Node>> c; // array of pointers to children
+        bool leaf {}; // boolean, true if it is a leaf
+        friend SnapshotBPlus;
+
+    public:
+        Node() : leaf(true) {}
+    };
+    using Ptr = shared_ptr<const Node>;
+
+    static int find(const Node* x, const T& k, bool strict = false) {
+        int i = 0;
+        for (; i < (int)x->key.size(); ++i)
+            if (strict ? k < x->key[i] : k <= x->key[i]) break;
+        return i;
+    }
+
+    static bool search(const Node* x, const T& k) {
+        while (!x->leaf) x = x->c[find(x, k, true)].get();
+        int i = find(x, k);
+        return i < (int)x->key.size() && x->key[i] == k;
+    }
+
+    static void traverse(const Node* x, const function<void(T)>& process) {
+        if (x->leaf) {
+            for (const T& k : x->key) process(k);
+            return;
+        }
+        for (const Ptr& child : x->c) traverse(child.get(), process);
+    }
+
+    // y holds 2t keys, moves its upper half into a new node z
+    void split(Node* y, shared_ptr<Node>& z, T& sep) {
+        z = make_shared<Node>();
+        z->leaf = y->leaf;
+        if (y->leaf) {
+            z->key.assign(y->key.begin() + t, y->key.end());
+            y->key.resize(t);
+            sep = z->key[0]; // copy a separator up
+        }
+        else {
+            sep = y->key[t]; // move middle key up
+            z->key.assign(y->key.begin() + t + 1, y->key.end());
+            z->c.assign(y->c.begin() + t + 1, y->c.end());
+            y->key.resize(t);
+            y->c.resize(t + 1);
+        }
+    }
+
+    // Copy of x with k inserted, or null if k was already there. When the
+    // copy overflows, its right half comes back in z with its separator.
+    shared_ptr<Node> insert(const Node* x, const T& k, shared_ptr<Node>& z, T& sep) {
+        int i = find(x, k, !x->leaf);
+        shared_ptr<Node> y;
+        if (x->leaf) {
+            if (i < (int)x->key.size() && x->key[i] == k) return nullptr;
+            y = make_shared<Node>(*x);
+            y->key.insert(y->key.begin() + i, k);
+        }
+        else {
+            shared_ptr<Node> cz;
+            T csep;
+            shared_ptr<Node> child = insert(x->c[i].get(), k, cz, csep);
+            if (child == nullptr) return nullptr;
+
+            y = make_shared<Node>(*x);
+            y->c[i] = child;
+            if (cz != nullptr) {
+                y->key.insert(y->key.begin() + i, csep);
+                y->c.insert(y->c.begin() + i + 1, cz);
+            }
+        }
+        if ((int)y->key.size() == (t<<1)) split(y.get(), z, sep);
+        return y;
+    }
+
+    // x->c[i] was replaced by y, which has t - 2 keys: borrow a key from a
+    // sibling or merge with it, copying the sibling as well
+    void refill(Node* x, int i, shared_ptr<Node> y) {
+        bool left = (i > 0);
+        int si = (left ? i - 1 : i + 1);
+        shared_ptr<Node> s = make_shared<Node>(*x->c[si]);
+        int sep = (left ? i - 1 : i); // separator between both
+
+        if ((int)s->key.size() >= t) { // borrow
+            if (left) {
+                if (y->leaf) {
+                    y->key.insert(y->key.begin(), s->key.back());
+                    x->key[sep] = y->key[0];
+                }
+                else {
+                    y->key.insert(y->key.begin(), x->key[sep]);
+                    y->c.insert(y->c.begin(), s->c.back());
+                    x->key[sep] = s->key.back();
+                    s->c.pop_back();
+                }
+                s->key.pop_back();
+            }
+            else {
+                if (y->leaf) {
+                    y->key.push_back(s->key.front());
+                    x->key[sep] = s->key[1];
+                }
+                else {
+                    y->key.push_back(x->key[sep]);
+                    y->c.push_back(s->c.front());
+                    x->key[sep] = s->key.front();
+                    s->c.erase(s->c.begin());
+                }
+                s->key.erase(s->key.begin());
+            }
+            x->c[i] = y;
+            x->c[si] = s;
+            return;
+        }
+
+        shared_ptr<Node> l = (left ? s : y), r = (left ? y : s); // merge
+        if (!l->leaf) l->key.push_back(x->key[sep]);
+        l->key.insert(l->key.end(), r->key.begin(), r->key.end());
+        l->c.insert(l->c.end(), r->c.begin(), r->c.end());
+        x->key.erase(x->key.begin() + sep);
+        x->c.erase(x->c.begin() + sep + 1);
+        x->c[sep] = l;
+    }
+
+    // copy of x with k removed, or null if k was not there
+    shared_ptr<Node> erase(const Node* x, const T& k) {
+        int i = find(x, k, !x->leaf);
+        if (x->leaf) {
+            if (i == (int)x->key.size() || !(x->key[i] == k)) return nullptr;
+            shared_ptr<Node> y = make_shared<Node>(*x);
+            y->key.erase(y->key.begin() + i);
+            return y;
+        }
+
+        shared_ptr<Node> child = erase(x->c[i].get(), k);
+        if (child == nullptr) return nullptr;
+
+        shared_ptr<Node> y = make_shared<Node>(*x);
+        if ((int)child->key.size() < t - 1) refill(y.get(), i, child);
+        else y->c[i] = child;
+        return y;
+    }
+
+    int t {};
+    Ptr root; // only accessed through atomic_load / atomic_store
+    mutex writer;
+
+public:
+    // a read-only version of the tree, unaffected by later writes
+    class Snapshot {
+        Ptr root;
+        friend SnapshotBPlus;
+        explicit Snapshot(Ptr root) : root(move(root)) {}
+
+    public:
+        bool search(T k) const { return SnapshotBPlus::search(root.get(), k); }
+        void traverse(function<void(T)> process) const { SnapshotBPlus::traverse(root.get(), process); }
+    };
+
+    explicit SnapshotBPlus(int t) : t(t), root(make_shared<Node>()) {}
+
+    Snapshot snapshot() const { return Snapshot(atomic_load(&root)); }
+
+    void insert(T k) {
+        lock_guard<mutex> guard(writer);
+        Ptr x = atomic_load(&root);
+
+        shared_ptr<Node> z;
+        T sep;
+        shared_ptr<Node> y = insert(x.get(), k, z, sep);
+        if (y == nullptr) return;
+        if (z != nullptr) { // root was split
+            shared_ptr<Node> s = make_shared<Node>();
+            s->leaf = false;
+            s->key.push_back(sep);
+            s->c.push_back(y);
+            s->c.push_back(z);
+            y = s;
+        }
+        atomic_store(&root, Ptr(y));
+    }
+    void erase(T k) {
+        lock_guard<mutex> guard(writer);
+        Ptr x = atomic_load(&root);
+
+        Ptr y = erase(x.get(), k);
+        if (y == nullptr) return;
+        if (!y->leaf && y->key.empty()) y = y->c[0]; // root lost its last separator
+        atomic_store(&root, y);
+    }
+    bool search(T k) const { return snapshot().search(k); }
+    void traverse(function<void(T)> process) const { snapshot().traverse(process); }
+    void clear() {
+        lock_guard<mutex> guard(writer);
+        atomic_store(&root, Ptr(make_shared<Node>()));
+    }
+};
+
+#endif //AED_TRIEB_SNAPSHOTBPLUS_H
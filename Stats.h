@@ -0,0 +1,41 @@
+#ifndef AED_TRIEB_STATS_H
+#define AED_TRIEB_STATS_H
+
+#include <cstddef>
+
+// Statistics policies for BTree and BPlus. The trees call these hooks as they
+// work, the default policy's hooks are empty and inline away entirely.
+struct NoStats {
+    void visit() {}
+    void compare(int) {}
+    void split() {}
+    void merge() {}
+    void borrow() {}
+    void allocate() {}
+    void grow() {}
+    void shrink() {}
+};
+
+// Counts every event, to tune the order of a tree
+struct CountStats {
+    size_t visits {}; // nodes entered by insert, erase, search and traverse
+    size_t comparisons {}; // key comparisons made scanning nodes
+    size_t splits {}; // nodes split in two (or more, by batch inserts)
+    size_t merges {}; // pairs of siblings merged by erase
+    size_t borrows {}; // keys borrowed from a sibling by erase
+    size_t allocations {}; // nodes allocated
+    size_t grows {}; // times the tree got a new root
+    size_t shrinks {}; // times the tree lost its root
+
+    void visit() { ++visits; }
+    void compare(int n) { comparisons += n; }
+    void split() { ++splits; }
+    void merge() { ++merges; }
+    void borrow() { ++borrows; }
+    void allocate() { ++allocations; }
+    void grow() { ++grows; }
+    void shrink() { ++shrinks; }
+    void reset() { *this = CountStats(); }
+};
+
+#endif //AED_TRIEB_STATS_H
@@ -0,0 +1,366 @@
+#ifndef AED_TRIEB_TRACE_H
+#define AED_TRIEB_TRACE_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#include "TreeFile.h"
+using namespace std;
+
+// Workload traces: Traced records the insert, erase, search and traverse
+// calls made on a Trie, BTree or BPlus to a binary log, and replay runs a
+// log against any of them, timing every call.
+//
+//   "AEDR", version u32, key type u32 (TreeFile::key_type), then one record
+//   per call: the op byte and, but for traverse, the key, raw for fixed-size
+//   keys and as a varint length and bytes for strings
+
+enum class TraceOp : uint8_t { insert, erase, search, traverse };
+
+const char* const trace_op_names[] = {"insert", "erase", "search", "traverse"};
+
+// Writes a trace through a buffer of TreeFile::block bytes, flushed when
+// full, by flush() and on destruction
+template<typename K>
+class TraceWriter {
+    ostream& out;
+    vector<char> buf;
+
+    void put(const void* p, size_t n) {
+        if (buf.size() + n > TreeFile::block) flush();
+        buf.insert(buf.end(), (const char*)p, (const char*)p + n);
+    }
+    template<typename U>
+    void put(U v) { put(&v, sizeof(U)); }
+
+public:
+    explicit TraceWriter(ostream& out) : out(out) {
+        buf.reserve(TreeFile::block);
+        put("AEDR", 4);
+        put((uint32_t)2);
+        put(TreeFile::key_type<K>());
+    }
+    TraceWriter(const TraceWriter&) = delete;
+    TraceWriter& operator=(const TraceWriter&) = delete;
+    ~TraceWriter() { flush(); }
+
+    void record(TraceOp op) { put((uint8_t)op); }
+    void record(TraceOp op, const K& k) {
+        put((uint8_t)op);
+        if constexpr (is_same<K, string>::value) {
+            char b[10];
+            int n = 0;
+            for (uint64_t v = k.size(); ; v >>= 7) {
+                b[n++] = (char)(v >= 0x80 ? (v & 0x7F) | 0x80 : v);
+                if (v < 0x80) break;
+            }
+            put(b, n);
+            put(k.data(), k.size());
+        }
+        else put(&k, sizeof(K));
+    }
+    void flush() {
+        out.write(buf.data(), (streamsize)buf.size());
+        out.flush();
+        buf.clear();
+    }
+};
+
+// Reads a trace back, checking its header on construction. next() returns
+// false at the end of the log and throws runtime_error on a cut record.
+template<typename K>
+class TraceReader {
+    istream& in;
+    vector<char> buf;
+    size_t pos {}, len {};
+
+    static void fail(const string& what) { throw runtime_error("trace: " + what); }
+
+    // makes n bytes available at pos, returns false if the log ends first
+    bool need(size_t n) {
+        if (len - pos >= n) return true;
+        len -= pos;
+        memmove(buf.data(), buf.data() + pos, len);
+        pos = 0;
+        if (buf.size() < n) buf.resize(n);
+        in.read(buf.data() + len, (streamsize)(buf.size() - len));
+        len += (size_t)in.gcount();
+        return len >= n;
+    }
+    void get(void* p, size_t n) {
+        if (!need(n)) fail("truncated");
+        memcpy(p, buf.data() + pos, n);
+        pos += n;
+    }
+
+public:
+    explicit TraceReader(istream& in) : in(in), buf(TreeFile::block) {
+        char head[12];
+        get(head, 12);
+        uint32_t version, type;
+        memcpy(&version, head + 4, 4);
+        memcpy(&type, head + 8, 4);
+        if (memcmp(head, "AEDR", 4) != 0) fail("not a trace");
+        if (version != 2) fail("unknown version");
+        if (type != TreeFile::key_type<K>()) fail("keys of another type");
+    }
+    bool next(TraceOp& op, K& k) {
+        if (!need(1)) {
+            if (len > pos) fail("truncated");
+            return false;
+        }
+        uint8_t b = (uint8_t)buf[pos++];
+        if (b > (uint8_t)TraceOp::traverse) fail("bad op");
+        op = (TraceOp)b;
+        if (op == TraceOp::traverse) return true;
+        if constexpr (is_same<K, string>::value) {
+            uint64_t n = 0;
+            for (int s = 0; ; s += 7) {
+                if (s >= 64) fail("bad length");
+                unsigned char c;
+                get(&c, 1);
+                n |= (uint64_t)(c & 0x7F) << s;
+                if (c < 0x80) break;
+            }
+            k.clear();
+            while (n > 0) { // at most a buffer at a time, lengths may be damaged
+                size_t m = (size_t)min<uint64_t>(n, TreeFile::block);
+                if (!need(m)) fail("truncated");
+                k.append(buf.data() + pos, m);
+                pos += m;
+                n -= m;
+            }
+        }
+        else get(&k, sizeof(K));
+        return true;
+    }
+};
+
+// Key type of the trace in (TreeFile::key_type), to pick the key type to
+// replay it with. Reads the header only, so in must be rewound after.
+inline uint32_t trace_key_type(istream& in) {
+    char head[12] {};
+    in.read(head, 12);
+    if (in.gcount() != 12 || memcmp(head, "AEDR", 4) != 0) throw runtime_error("trace: not a trace");
+    uint32_t type;
+    memcpy(&type, head + 8, 4);
+    return type;
+}
+
+// Forwards every call to s, recording it to log first
+template<typename S, typename K>
+class Traced {
+    S& s;
+    TraceWriter<K> log;
+
+public:
+    Traced(S& s, ostream& log) : s(s), log(log) {}
+
+    void insert(const K& k) {
+        log.record(TraceOp::insert, k);
+        s.insert(k);
+    }
+    void erase(const K& k) {
+        log.record(TraceOp::erase, k);
+        s.erase(k);
+    }
+    bool search(const K& k) {
+        log.record(TraceOp::search, k);
+        return s.search(k);
+    }
+    template<typename F>
+    void traverse(F process) {
+        log.record(TraceOp::traverse);
+        s.traverse(process);
+    }
+    void flush() { log.flush(); }
+    S& get() { return s; }
+};
+
+// Latency histogram in nanoseconds. Values below 32 get a bucket each, and
+// every power of two above that is split in 16, so any value is off by
+// about 6% at most, as in HdrHistogram.
+class Histogram {
+    static constexpr int sub = 16;
+    vector<uint64_t> counts = vector<uint64_t>(64 * sub);
+
+    static int bucket(uint64_t v) {
+        if (v < 2 * sub) return (int)v;
+        int e = 63 - __builtin_clzll(v);
+        return (e - 3) * sub + (int)((v >> (e - 4)) & (sub - 1));
+    }
+    static uint64_t low(int b) {
+        if (b < 2 * sub) return (uint64_t)b;
+        return (uint64_t)(sub + b % sub) << (b / sub - 1);
+    }
+
+public:
+    uint64_t count {}, max {};
+    double sum {};
+
+    void add(uint64_t ns) {
+        counts[bucket(ns)] += 1;
+        count += 1;
+        max = std::max(max, ns);
+        sum += (double)ns;
+    }
+    void merge(const Histogram& o) {
+        for (size_t b = 0; b < counts.size(); ++b) counts[b] += o.counts[b];
+        count += o.count;
+        max = std::max(max, o.max);
+        sum += o.sum;
+    }
+    double mean() const { return count > 0 ? sum / (double)count : 0; }
+    // smallest value of the bucket holding the p-th quantile, p in [0, 1]
+    uint64_t percentile(double p) const {
+        if (count == 0) return 0;
+        uint64_t rank = std::max<uint64_t>(1, (uint64_t)(p * (double)count + 0.5));
+        uint64_t seen = 0;
+        for (size_t b = 0; b < counts.size(); ++b) {
+            seen += counts[b];
+            if (seen >= rank) return low((int)b);
+        }
+        return max;
+    }
+};
+
+// Hardware counters of this thread through perf_event_open, user space
+// only. Counters the kernel refuses (no PMU in a VM, perf_event_paranoid)
+// are left out and read as unavailable.
+class PerfCounters {
+    int fd[4] = {-1, -1, -1, -1};
+
+public:
+    static constexpr int n = 4;
+    static constexpr const char* names[n] = {"cycles", "instructions", "cache_misses", "branch_misses"};
+    uint64_t value[n] {};
+
+    PerfCounters() {
+#ifdef __linux__
+        const uint64_t config[n] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                    PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+        for (int i = 0; i < n; ++i) {
+            perf_event_attr attr {};
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = config[i];
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            fd[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        }
+#endif
+    }
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+    ~PerfCounters() {
+#ifdef __linux__
+        for (int f : fd)
+            if (f >= 0) close(f);
+#endif
+    }
+
+    bool available(int i) const { return fd[i] >= 0; }
+    // counting resumes where the last stop left it
+    void start() {
+#ifdef __linux__
+        for (int f : fd)
+            if (f >= 0) ioctl(f, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+    }
+    void stop() {
+#ifdef __linux__
+        for (int i = 0; i < n; ++i) {
+            if (fd[i] < 0) continue;
+            ioctl(fd[i], PERF_EVENT_IOC_DISABLE, 0);
+            if (read(fd[i], &value[i], sizeof(uint64_t)) != sizeof(uint64_t)) value[i] = 0;
+        }
+#endif
+    }
+};
+
+struct ReplayReport {
+    uint64_t ops[4] {}; // calls of each TraceOp
+    Histogram latency[4]; // per TraceOp, with the clock's overhead (~20 ns)
+    double seconds {}; // running the calls, decoding the log left out
+    uint64_t hits {}; // searches that found their key
+    uint64_t visited {}; // keys traversals went through
+    bool counted[PerfCounters::n] {};
+    uint64_t counter[PerfCounters::n] {};
+};
+
+// whether S has traverse, for structures without one
+template<typename S, typename K, typename = void>
+struct can_traverse : false_type {};
+template<typename S, typename K>
+struct can_traverse<S, K, void_t<decltype(declval<S&>().traverse(function<void(K)>()))>> : true_type {};
+
+// Runs the calls of a trace against s. The log is decoded in batches of
+// `batch` calls, and only running them is timed and counted, so replays of
+// one trace against different structures compare the structures alone.
+// With time_each off no call is timed on its own, which leaves the clock
+// out of seconds and the counters, and the histograms empty.
+template<typename S, typename K>
+ReplayReport replay(istream& in, S& s, bool time_each = true, size_t batch = 1 << 16) {
+    using clock = chrono::steady_clock;
+    TraceReader<K> reader(in);
+    ReplayReport report;
+    PerfCounters perf;
+    vector<pair<TraceOp, K>> calls(max<size_t>(batch, 1));
+
+    auto call = [&](TraceOp op, const K& k) {
+        switch (op) {
+        case TraceOp::insert: s.insert(k); break;
+        case TraceOp::erase: s.erase(k); break;
+        case TraceOp::search: report.hits += s.search(k); break;
+        case TraceOp::traverse:
+            if constexpr (can_traverse<S, K>::value)
+                s.traverse([&report](const K&) { report.visited += 1; });
+            break;
+        }
+    };
+
+    for (;;) {
+        size_t m = 0;
+        while (m < calls.size() && reader.next(calls[m].first, calls[m].second)) ++m;
+        if (m == 0) break;
+
+        perf.start();
+        auto start = clock::now();
+        for (size_t i = 0; i < m; ++i) {
+            TraceOp op = calls[i].first;
+            if (time_each) {
+                auto t0 = clock::now();
+                call(op, calls[i].second);
+                report.latency[(int)op].add((uint64_t)chrono::duration_cast<chrono::nanoseconds>(clock::now() - t0).count());
+            }
+            else call(op, calls[i].second);
+            report.ops[(int)op] += 1;
+        }
+        report.seconds += chrono::duration<double>(clock::now() - start).count();
+        perf.stop();
+        if (m < calls.size()) break;
+    }
+    for (int i = 0; i < PerfCounters::n; ++i) {
+        report.counted[i] = perf.available(i);
+        report.counter[i] = perf.value[i];
+    }
+    return report;
+}
+
+#endif //AED_TRIEB_TRACE_H
@@ -0,0 +1,244 @@
+#ifndef AED_TRIEB_TREEFILE_H
+#define AED_TRIEB_TREEFILE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+using namespace std;
+
+// File format of BTree::save and BPlus::save, the same for both so either
+// tree restores the other's:
+//
+//   "AEDT", version u32, key type u32, t u32, height u32, count u64, the
+//   keys in ascending order, checksum u64
+//
+// The key type is the kind of key (TreeFile::Kind) in the high half and its
+// size in the low one, so a file of floats does not restore into a tree of
+// ints of the same size, or unsigned into signed, each ordering the bits
+// differently.
+//
+// Fixed-size keys are stored raw in native byte order, as ExternalSort
+// reads them. Strings are front-coded: the length of the prefix shared with
+// the key before, the length of the rest and the rest, lengths as varints.
+// The checksum covers every byte before it. t and height describe the tree
+// saved; a tree restores the keys into its own order.
+
+// 64-bit checksum of a byte stream, eight bytes at a time whatever the
+// pieces it arrives in
+class Checksum {
+    uint64_t h = 0x9E3779B97F4A7C15ULL;
+    uint64_t word {}; // bytes of the word being filled
+    int fill {};
+    uint64_t bytes {};
+
+    void mix(uint64_t w) {
+        h ^= w * 0xFF51AFD7ED558CCDULL;
+        h = (h << 31 | h >> 33) * 0xC4CEB9FE1A85EC53ULL;
+    }
+    void push(char b) {
+        word |= (uint64_t)(unsigned char)b << (8 * fill);
+        if (++fill == 8) {
+            mix(word);
+            word = 0;
+            fill = 0;
+        }
+    }
+
+public:
+    void update(const char* p, size_t n) {
+        bytes += n;
+        for (; n > 0 && fill > 0; --n) push(*p++);
+        for (; n >= 8; p += 8, n -= 8) {
+            uint64_t w;
+            memcpy(&w, p, 8);
+            mix(w);
+        }
+        for (; n > 0; --n) push(*p++);
+    }
+    uint64_t value() const {
+        Checksum c = *this;
+        if (c.fill > 0) c.mix(c.word);
+        c.mix(c.bytes);
+        return c.h ^ c.h >> 29;
+    }
+};
+
+// constants of the format
+struct TreeFile {
+    static constexpr char magic[4] = {'A', 'E', 'D', 'T'};
+    static constexpr uint32_t version = 2;
+    static constexpr size_t block = 1 << 20; // bytes per read or write
+
+    enum Kind : uint32_t { string_key, signed_key, unsigned_key, floating_key, other_key };
+    static constexpr const char* kind_names[] = {"string", "signed", "unsigned", "floating", "other"};
+
+    // kind << 16 | size of T, 0 for strings
+    template<typename T>
+    static uint32_t key_type() {
+        if constexpr (is_same<T, string>::value) return string_key << 16;
+        else {
+            static_assert(is_trivially_copyable<T>::value, "keys are saved as raw bytes or as strings");
+            uint32_t kind = is_floating_point<T>::value ? floating_key
+                          : !is_integral<T>::value ? other_key
+                          : is_signed<T>::value ? signed_key : unsigned_key;
+            return kind << 16 | (uint32_t)sizeof(T);
+        }
+    }
+};
+
+// Writes a tree file through a buffer of TreeFile::block bytes. The
+// header goes first, then key(k) for each of the `count` keys in order,
+// then finish().
+template<typename T>
+class TreeWriter {
+    ostream& out;
+    vector<char> buf;
+    Checksum sum;
+    T last {}; // previous key, for front coding
+
+    void flush() {
+        sum.update(buf.data(), buf.size());
+        out.write(buf.data(), (streamsize)buf.size());
+        buf.clear();
+    }
+    void put(const void* p, size_t n) {
+        if (buf.size() + n > TreeFile::block) flush();
+        if (n > TreeFile::block) {
+            sum.update((const char*)p, n);
+            out.write((const char*)p, (streamsize)n);
+        }
+        else buf.insert(buf.end(), (const char*)p, (const char*)p + n);
+    }
+    template<typename U>
+    void put(U v) { put(&v, sizeof(U)); }
+    void varint(uint64_t v) {
+        char b[10];
+        int n = 0;
+        for (; v >= 0x80; v >>= 7) b[n++] = (char)(v | 0x80);
+        b[n++] = (char)v;
+        put(b, n);
+    }
+
+public:
+    TreeWriter(ostream& out, int t, int height, uint64_t count) : out(out) {
+        buf.reserve(TreeFile::block);
+        put(TreeFile::magic, 4);
+        put(TreeFile::version);
+        put(TreeFile::key_type<T>());
+        put((uint32_t)t);
+        put((uint32_t)height);
+        put(count);
+    }
+    void key(const T& k) {
+        if constexpr (is_same<T, string>::value) {
+            size_t l = 0;
+            while (l < last.size() && l < k.size() && last[l] == k[l]) ++l;
+            varint(l);
+            varint(k.size() - l);
+            put(k.data() + l, k.size() - l);
+            last.replace(l, string::npos, k, l);
+        }
+        else put(&k, sizeof(T));
+    }
+    void finish() {
+        flush();
+        uint64_t c = sum.value();
+        out.write((const char*)&c, sizeof(c));
+        out.flush();
+        if (!out) throw runtime_error("tree file: write failed");
+    }
+};
+
+// Reads a tree file through a buffer of TreeFile::block bytes. The header
+// is read and checked on construction, then key(k) reads each of the
+// `count` keys in order and finish() checks the checksum. Any damage
+// found throws runtime_error.
+template<typename T>
+class TreeReader {
+    istream& in;
+    vector<char> buf;
+    size_t pos {}, len {};
+    size_t summed {}; // bytes of buf checksummed so far
+    Checksum sum;
+    T last {};
+
+    static void fail(const string& what) { throw runtime_error("tree file: " + what); }
+
+    // makes at least n bytes available at pos
+    void need(size_t n) {
+        if (len - pos >= n) return;
+        sum.update(buf.data() + summed, pos - summed);
+        len -= pos;
+        memmove(buf.data(), buf.data() + pos, len);
+        pos = summed = 0;
+        if (buf.size() < n) buf.resize(n);
+        in.read(buf.data() + len, (streamsize)(buf.size() - len));
+        len += (size_t)in.gcount();
+        if (len < n) fail("truncated");
+    }
+    void get(void* p, size_t n) {
+        need(n);
+        memcpy(p, buf.data() + pos, n);
+        pos += n;
+    }
+    template<typename U>
+    U get() {
+        U v;
+        get(&v, sizeof(U));
+        return v;
+    }
+    uint64_t varint() {
+        uint64_t v = 0;
+        for (int s = 0; s < 64; s += 7) {
+            auto b = get<unsigned char>();
+            v |= (uint64_t)(b & 0x7F) << s;
+            if (b < 0x80) return v;
+        }
+        fail("bad length");
+        return 0;
+    }
+
+public:
+    int t {}, height {}; // of the tree saved
+    uint64_t count {};
+
+    explicit TreeReader(istream& in) : in(in), buf(TreeFile::block) {
+        char m[4];
+        get(m, 4);
+        if (memcmp(m, TreeFile::magic, 4) != 0) fail("not a tree file");
+        if (get<uint32_t>() != TreeFile::version) fail("unknown version");
+        if (get<uint32_t>() != TreeFile::key_type<T>()) fail("keys of another type");
+        t = (int)get<uint32_t>();
+        height = (int)get<uint32_t>();
+        count = get<uint64_t>();
+    }
+    void key(T& k) {
+        if constexpr (is_same<T, string>::value) {
+            uint64_t l = varint(), r = varint();
+            if (l > last.size()) fail("bad prefix");
+            last.resize(l);
+            while (r > 0) { // at most a buffer at a time, lengths may be damaged
+                size_t n = (size_t)min<uint64_t>(r, TreeFile::block);
+                need(n);
+                last.append(buf.data() + pos, n);
+                pos += n;
+                r -= n;
+            }
+            k = last;
+        }
+        else get(&k, sizeof(T));
+    }
+    void finish() {
+        sum.update(buf.data() + summed, pos - summed);
+        summed = pos;
+        if (get<uint64_t>() != sum.value()) fail("checksum mismatch");
+    }
+};
+
+#endif //AED_TRIEB_TREEFILE_H
@@ -5,7 +5,11 @@
 #ifndef ADS_HW5_TRIE_H
 #define ADS_HW5_TRIE_H
 
+#include<functional>
 #include<string>
+#include<string_view>
+#include<unordered_map>
+#include<vector>
 using namespace std;
 
 class Trie {
@@ -14,89 +18,103 @@ class Trie {
         Node* next {};
         Node* child {};
         bool endOfWord {};
+        int count {}; // words ending in this node or below it
         friend Trie;
     public:
         Node() = default;
         explicit Node(char value) : val(value) {}
     };
 
-    void _first_insert(Node* cur, const string& s, int i) {
-        int n = (int)s.size();
-        for (; i < n; ++i) {
-            cur->child = new Node(s[i]);
-            cur = cur->child;
-        }
-        cur->endOfWord = true;
+    // siblings are kept sorted by byte, so words are in string order
+    static bool before(char a, char b) { return (unsigned char)a < (unsigned char)b; }
+
+    // link to the node for c in the sibling list at head, or to where it goes
+    static Node** _find(Node** head, char c) {
+        while (*head && before((*head)->val, c)) head = &(*head)->next;
+        return head;
     }
 
-    void _insert(Node* cur, const string& s, int i) {
-        if (i == (int)s.size()) {
-            cur->endOfWord = true;
-            return;
+    // returns true if s was not in the trie yet
+    bool _insert(Node** head, string_view s, int i) {
+        Node** link = _find(head, s[i]);
+        if (*link == nullptr || (*link)->val != s[i]) {
+            Node* node = new Node(s[i]);
+            node->next = *link;
+            *link = node;
         }
+        Node* cur = *link;
 
-        while (cur->next) {
-            if (cur->val == s[i]) break;
-            cur = cur->next;
-        }
-        if (cur->val != s[i]) {
-            cur->next = new Node(s[i]);
-            _first_insert(cur->next, s, ++i);
-        }
-        else {
-            if (cur->child) _insert(cur->child, s, ++i);
-            else _first_insert(cur, s, ++i);
+        bool added;
+        if (i == (int)s.size() - 1) {
+            added = !cur->endOfWord;
+            cur->endOfWord = true;
         }
+        else added = _insert(&cur->child, s, i + 1);
+
+        if (added) cur->count += 1;
+        return added;
     }
 
-    Node* _erase(Node* cur, const string& s, int i) {
-        if (cur == nullptr) return cur;
-        if (i == (int)s.size() - 1) {
-            if (!cur->endOfWord) return cur;
-            else if (cur->child) {
-                cur->endOfWord = false;
-                return cur;
-            }
-            else if (cur->next) {
-                Node* nxt = cur->next;
-                delete cur;
-                return nxt;
-            }
-            else {
-                delete cur;
-                return nullptr;
-            }
-        }
+    // returns true if s was in the trie
+    bool _erase(Node** head, const string& s, int i) {
+        Node** link = _find(head, s[i]);
+        Node* cur = *link;
+        if (cur == nullptr || cur->val != s[i]) return false;
 
-        while (cur->next) {
-            if (cur->val == s[i]) break;
-            cur = cur->next;
+        bool removed;
+        if (i == (int)s.size() - 1) {
+            removed = cur->endOfWord;
+            cur->endOfWord = false;
         }
-        if (cur->val != s[i] || !cur->child) return cur;
-
-        cur->child = _erase(cur->child, s, ++i);
+        else removed = _erase(&cur->child, s, i + 1);
+        if (!removed) return false;
 
-        if (cur->child || cur->endOfWord) return cur;
-        else if (cur->next) {
-            Node* nxt = cur->next;
+        cur->count -= 1;
+        if (cur->count == 0) { // no words left below, so no children either
+            *link = cur->next;
             delete cur;
-            return nxt;
         }
-        else {
-            delete cur;
-            return nullptr;
+        return true;
+    }
+
+    // merges the sorted sibling list b into the one at a, moving b's nodes
+    // over or freeing them, never copying
+    static void _merge(Node** a, Node* b) {
+        while (b) {
+            Node* next = b->next;
+            a = _find(a, b->val);
+            if (*a == nullptr || (*a)->val != b->val) {
+                b->next = *a;
+                *a = b;
+            }
+            else {
+                Node* cur = *a;
+                _merge(&cur->child, b->child);
+                cur->endOfWord |= b->endOfWord;
+                cur->count = cur->endOfWord;
+                for (Node* c = cur->child; c; c = c->next)
+                    cur->count += c->count;
+                delete b;
+            }
+            a = &(*a)->next;
+            b = next;
         }
     }
 
     bool _search(Node* cur, const string& s, int i) {
-        if (cur == nullptr) return false;
+        cur = *_find(&cur, s[i]);
+        if (cur == nullptr || cur->val != s[i]) return false;
+        if (i == (int)s.size() - 1) return cur->endOfWord;
+        return _search(cur->child, s, ++i);
+    }
 
-        while (cur->next) {
-            if (cur->val == s[i]) break;
-            cur = cur->next;
+    void _traverse(Node* cur, string& word, const function<void(string)>& process) {
+        for (; cur; cur = cur->next) {
+            word += cur->val;
+            if (cur->endOfWord) process(word);
+            _traverse(cur->child, word, process);
+            word.pop_back();
         }
-        if (cur->val == s[i]) return (i == (int)s.size() - 1 && cur->endOfWord) || _search(cur->child, s, ++i);
-        return false;
     }
 
     void _clear(Node* cur) {
@@ -106,7 +124,57 @@ class Trie {
         delete cur;
     }
 
+    // what makes two nodes interchangeable once their children and
+    // following siblings are shared already
+    struct Shape {
+        char val;
+        bool endOfWord;
+        Node* child;
+        Node* next;
+        bool operator==(const Shape& o) const {
+            return val == o.val && endOfWord == o.endOfWord && child == o.child && next == o.next;
+        }
+    };
+    struct ShapeHash {
+        size_t operator()(const Shape& s) const {
+            size_t h = hash<Node*>()(s.child) * 31 + hash<Node*>()(s.next);
+            return h * 31 + (unsigned char)s.val * 2 + s.endOfWord;
+        }
+    };
+
+    // replaces every subtree by the first equal one seen, bottom up
+    Node* _minimize(Node* cur, unordered_map<Shape, Node*, ShapeHash>& seen) {
+        if (cur == nullptr) return nullptr;
+        cur->child = _minimize(cur->child, seen);
+        cur->next = _minimize(cur->next, seen);
+        auto [it, added] = seen.insert({{cur->val, cur->endOfWord, cur->child, cur->next}, cur});
+        if (!added) delete cur;
+        return it->second;
+    }
+
+    Node* _copy(Node* cur) {
+        if (cur == nullptr) return nullptr;
+        Node* node = new Node(*cur);
+        node->child = _copy(cur->child);
+        node->next = _copy(cur->next);
+        return node;
+    }
+
+    // turns a minimized trie back into a tree before it changes
+    void _unshare() {
+        if (shared.empty()) return;
+        Node* tree = _copy(root);
+        for (Node* node : shared) delete node;
+        shared.clear();
+        root = tree;
+    }
+
+    int _nodes(Node* cur) {
+        return cur == nullptr ? 0 : 1 + _nodes(cur->child) + _nodes(cur->next);
+    }
+
     Node* root {};
+    vector<Node*> shared; // every node, while the trie is minimized
 public:
     Trie() = default;
     ~Trie() {
@@ -114,20 +182,122 @@ public:
     }
     void insert(const string& s) {
         if (s.empty()) return;
-        if (root) _insert(root, s, 0);
-        else {
-            root = new Node(s[0]);
-            _first_insert(root, s, 1);
-        }
+        _unshare();
+        _insert(&root, s, 0);
+    }
+    void insert(const char* s, size_t n) {
+        if (n == 0) return;
+        _unshare();
+        _insert(&root, string_view(s, n), 0);
     }
     void erase(const string& s) {
         if (s.empty()) return;
-        _erase(root, s, 0);
+        _unshare();
+        _erase(&root, s, 0);
+    }
+    // moves every word of other into this trie, other is left empty
+    void merge(Trie& other) {
+        if (&other == this) return;
+        _unshare();
+        other._unshare();
+        _merge(&root, other.root);
+        other.root = nullptr;
     }
     bool search(const string& s) {
         return !s.empty() && _search(root, s, 0);
     }
-    void clear() { _clear(root); }
+    // calls process on every word in string order
+    void traverse(function<void(string)> process) {
+        string word;
+        _traverse(root, word, process);
+    }
+    // longest word in the trie that is a prefix of s, or "" if there is none
+    string longest_prefix_match(const string& s) {
+        size_t best = 0;
+        Node* cur = root;
+        for (size_t i = 0; i < s.size(); ++i) {
+            cur = *_find(&cur, s[i]);
+            if (cur == nullptr || cur->val != s[i]) break;
+            if (cur->endOfWord) best = i + 1;
+            cur = cur->child;
+        }
+        return s.substr(0, best);
+    }
+    void clear() {
+        if (shared.empty()) _clear(root);
+        for (Node* node : shared) delete node;
+        shared.clear();
+        root = nullptr;
+    }
+
+    // Merges equal subtrees into one node each, so that common suffixes
+    // are stored once and the trie becomes a minimal acyclic automaton
+    // (DAWG) for its words. Lookups and ids work the same on it; the next
+    // insert, erase or merge copies it back into a tree first.
+    void minimize() {
+        if (!shared.empty()) return;
+        unordered_map<Shape, Node*, ShapeHash> seen;
+        root = _minimize(root, seen);
+        for (auto& [shape, node] : seen) shared.push_back(node);
+    }
+    // distinct nodes in memory
+    int nodes() {
+        return shared.empty() ? _nodes(root) : (int)shared.size();
+    }
+
+    // Interning: every word's id is its rank among the words in the trie,
+    // so ids are dense (0 to size() - 1) and order-preserving, and inserting
+    // or erasing a word shifts the ids of the words after it.
+    int size() {
+        int n = 0;
+        for (Node* cur = root; cur; cur = cur->next) n += cur->count;
+        return n;
+    }
+    // id of s, or -1 if s is not in the trie
+    int id_of(const string& s) {
+        if (s.empty()) return -1;
+        int id = 0;
+        Node* head = root;
+        for (int i = 0; i < (int)s.size(); ++i) {
+            Node* cur = head;
+            for (; cur && before(cur->val, s[i]); cur = cur->next)
+                id += cur->count; // every word under a smaller sibling comes first
+            if (cur == nullptr || cur->val != s[i]) return -1;
+            if (i == (int)s.size() - 1) return cur->endOfWord ? id : -1;
+            id += cur->endOfWord; // and so does the prefix s[0..i]
+            head = cur->child;
+        }
+        return -1;
+    }
+    // word whose id is id, or "" if there is none
+    string string_of(int id) {
+        if (id < 0 || id >= size()) return "";
+        string s;
+        Node* cur = root;
+        while (cur) {
+            if (id >= cur->count) {
+                id -= cur->count;
+                cur = cur->next;
+                continue;
+            }
+            s += cur->val;
+            if (cur->endOfWord) {
+                if (id == 0) return s;
+                id -= 1;
+            }
+            cur = cur->child;
+        }
+        return s;
+    }
+    // Dictionary-encodes a column: interns every value first, so the ids
+    // are final, then maps each value to its id (-1 for empty strings)
+    vector<int> encode(const vector<string>& column) {
+        for (const string& s : column) insert(s);
+        vector<int> ids;
+        ids.reserve(column.size());
+        for (const string& s : column) ids.push_back(id_of(s));
+        return ids;
+    }
 };
 
 #endif //ADS_HW5_TRIE_H
@@ -0,0 +1,137 @@
+#ifndef AED_TRIEB_TRIEINGEST_H
+#define AED_TRIEB_TRIEINGEST_H
+
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "Trie.h"
+using namespace std;
+
+// Calls word(p, n) for every maximal run of bytes in [first, last) that are
+// not in delims. With SSE2 and up to 8 delimiters, 16 bytes are checked at
+// a time against every delimiter and the matches walked as a bit mask.
+template<typename F>
+void tokenize(const char* first, const char* last, const string& delims, F word) {
+    bool delim[256] = {};
+    for (char d : delims) delim[(unsigned char)d] = true;
+
+    const char* start = first; // where the current word begins
+    const char* p = first;
+#ifdef __SSE2__
+    if (delims.size() <= 8) {
+        __m128i d[8];
+        for (size_t i = 0; i < delims.size(); ++i)
+            d[i] = _mm_set1_epi8(delims[i]);
+        for (; p + 16 <= last; p += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i*)p);
+            __m128i m = _mm_setzero_si128();
+            for (size_t i = 0; i < delims.size(); ++i)
+                m = _mm_or_si128(m, _mm_cmpeq_epi8(v, d[i]));
+            for (unsigned bits = _mm_movemask_epi8(m); bits != 0; bits &= bits - 1) {
+                const char* q = p + __builtin_ctz(bits);
+                if (q > start) word(start, (size_t)(q - start));
+                start = q + 1;
+            }
+        }
+    }
+#endif
+    for (; p < last; ++p)
+        if (delim[(unsigned char)*p]) {
+            if (p > start) word(start, (size_t)(p - start));
+            start = p + 1;
+        }
+    if (last > start) word(start, (size_t)(last - start));
+}
+
+// Inserts every word of the given files into trie, words being separated by
+// any byte in delims. Files are mapped into memory and cut into chunks at
+// delimiters, threads take chunks as they go and fill a trie each, and the
+// partial tries are merged pairwise in parallel by relinking their nodes.
+inline void ingest(Trie& trie, const vector<string>& paths, int threads = (int)thread::hardware_concurrency(),
+                   const string& delims = " \t\r\n") {
+    threads = max(threads, 1);
+    bool delim[256] = {};
+    for (char d : delims) delim[(unsigned char)d] = true;
+
+    struct File {
+        const char* data;
+        size_t size;
+    };
+    vector<File> files;
+    auto unmap = [&files]() {
+        for (File& f : files)
+            if (f.size > 0) munmap((void*)f.data, f.size);
+    };
+    for (const string& path : paths) {
+        int fd = open(path.c_str(), O_RDONLY);
+        struct stat st {};
+        if (fd < 0 || fstat(fd, &st) != 0) {
+            if (fd >= 0) close(fd);
+            unmap();
+            throw runtime_error("ingest: cannot open " + path);
+        }
+        size_t size = (size_t)st.st_size;
+        void* data = (size > 0 ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr);
+        close(fd);
+        if (data == MAP_FAILED) {
+            unmap();
+            throw runtime_error("ingest: cannot map " + path);
+        }
+        if (size > 0) madvise(data, size, MADV_SEQUENTIAL);
+        files.push_back({(const char*)data, size});
+    }
+
+    // chunks of about 4 MiB, 4 per thread at least, each starting right
+    // after a delimiter so no word is cut
+    struct Chunk {
+        const char* first;
+        const char* last;
+    };
+    vector<Chunk> chunks;
+    size_t total = 0;
+    for (File& f : files) total += f.size;
+    size_t target = max<size_t>(1 << 16, min<size_t>(4 << 20, total / ((size_t)threads * 4) + 1));
+    for (File& f : files) {
+        const char* end = f.data + f.size;
+        const char* first = f.data;
+        while (first < end) {
+            const char* last = (size_t)(end - first) > target ? first + target : end;
+            while (last < end && !delim[(unsigned char)last[-1]]) ++last;
+            chunks.push_back({first, last});
+            first = last;
+        }
+    }
+
+    vector<Trie> parts(threads);
+    atomic<size_t> next {0};
+    auto worker = [&](int j) {
+        for (size_t i = next++; i < chunks.size(); i = next++)
+            tokenize(chunks[i].first, chunks[i].last, delims, [&](const char* s, size_t n) { parts[j].insert(s, n); });
+    };
+    vector<thread> pool;
+    for (int j = 1; j < threads; ++j)
+        pool.emplace_back(worker, j);
+    worker(0);
+    for (thread& th : pool) th.join();
+    unmap();
+
+    for (int step = 1; step < threads; step *= 2) { // parts[j] takes parts[j + step]
+        pool.clear();
+        for (int j = 0; j + step < threads; j += 2 * step)
+            pool.emplace_back([&parts, j, step]() { parts[j].merge(parts[j + step]); });
+        for (thread& th : pool) th.join();
+    }
+    trie.merge(parts[0]);
+}
+
+#endif //AED_TRIEB_TRIEINGEST_H
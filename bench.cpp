@@ -0,0 +1,337 @@
+// Benchmarks every structure in the repo against std::set / std::unordered_set
+// on the same generated workload and prints one JSON object per structure.
+//
+//   g++ -O2 -std=c++17 -pthread bench.cpp -o bench
+//   ./bench --workload zipf --keys 1000000 --ops 1000000 --read-ratio 0.9
+//   ./bench --workload words --words /usr/share/dict/words
+//
+// Options: --workload uniform|zipf|sequential|words, --keys N (inserted before
+// timing the mixed phase), --ops M, --read-ratio R (share of searches in the
+// mixed phase, the rest are inserts), --t T (minimum degree of the trees),
+// --seed S, --words FILE, --only NAME (run a single structure).
+//
+// bytes_per_key is the heap growth while building divided by the number of
+// distinct keys. Latencies time each operation on its own, replaying the mixed
+// phase on a second copy of the structure built the same way, so they include
+// the clock's overhead (~20 ns), while ns_per_op and ops_per_sec do not.
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <new>
+#include <random>
+#include <set>
+#include <string>
+#include <type_traits>
+#include <unordered_set>
+#include <vector>
+#include "Trie.h"
+#include "BurstTrie.h"
+#include "BTree.h"
+#include "BPlus.h"
+#include "ConcurrentBPlus.h"
+#include "SnapshotBPlus.h"
+#include "PackedBPlus.h"
+#include "Pool.h"
+#include "betree.h"
+namespace legacy {
+#include "bplustree.h" // its BTree would clash with BTree<T>
+}
+using namespace std;
+
+// Heap accounting: every allocation carries its size in a header
+static size_t live_bytes = 0;
+
+void* operator new(size_t n) {
+    void* p = malloc(n + 16);
+    if (p == nullptr) throw bad_alloc();
+    *(size_t*)p = n;
+    live_bytes += n;
+    return (char*)p + 16;
+}
+void operator delete(void* p) noexcept {
+    if (p == nullptr) return;
+    p = (char*)p - 16;
+    live_bytes -= *(size_t*)p;
+    free(p);
+}
+void operator delete(void* p, size_t) noexcept { operator delete(p); }
+
+// Over-aligned types (ConcurrentBPlus's epoch slots, say) come here, with a
+// header as large as the alignment so the block stays aligned
+void* operator new(size_t n, align_val_t al) {
+    size_t a = max<size_t>((size_t)al, 16);
+    void* p = aligned_alloc(a, (n + 2 * a - 1) / a * a);
+    if (p == nullptr) throw bad_alloc();
+    *(size_t*)((char*)p + a - 16) = n;
+    live_bytes += n;
+    return (char*)p + a;
+}
+void operator delete(void* p, align_val_t al) noexcept {
+    if (p == nullptr) return;
+    live_bytes -= *(size_t*)((char*)p - 16);
+    free((char*)p - max<size_t>((size_t)al, 16));
+}
+void operator delete(void* p, size_t, align_val_t al) noexcept { operator delete(p, al); }
+
+struct Config {
+    string workload = "uniform";
+    string words;
+    string only;
+    size_t keys = 1000000;
+    size_t ops = 1000000;
+    double read_ratio = 0.5;
+    int t = 16;
+    uint64_t seed = 42;
+};
+
+template<typename K>
+struct Workload {
+    vector<K> build; // keys inserted before the mixed phase
+    vector<K> keys; // key of each mixed operation
+    vector<bool> read; // true if the operation is a search
+    size_t distinct {};
+};
+
+// Zipfian ranks in [0, n) with skew theta (Gray et al., as used by YCSB)
+class Zipf {
+    uint64_t n;
+    double theta, alpha, zetan, eta;
+    uniform_real_distribution<double> unit {0.0, 1.0};
+
+    static double zeta(uint64_t n, double theta) {
+        double sum = 0;
+        for (uint64_t i = 1; i <= n; ++i)
+            sum += 1.0 / pow((double)i, theta);
+        return sum;
+    }
+
+public:
+    explicit Zipf(uint64_t n, double theta = 0.99) : n(n), theta(theta) {
+        alpha = 1.0 / (1.0 - theta);
+        zetan = zeta(n, theta);
+        eta = (1 - pow(2.0 / (double)n, 1 - theta)) / (1 - zeta(2, theta) / zetan);
+    }
+    template<typename G>
+    uint64_t operator()(G& rng) {
+        double u = unit(rng), uz = u * zetan;
+        if (uz < 1.0) return 0;
+        if (uz < 1.0 + pow(0.5, theta)) return 1;
+        return min<uint64_t>(n - 1, (uint64_t)((double)n * pow(eta * u - eta + 1, alpha)));
+    }
+};
+
+// spreads popular ranks over the key space
+static int scramble(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return (int)(x & 0x7fffffff);
+}
+
+static Workload<int> make_ints(const Config& cfg) {
+    Workload<int> w;
+    mt19937_64 rng(cfg.seed);
+    uniform_int_distribution<int> any(0, 0x7fffffff);
+    uniform_real_distribution<double> coin(0.0, 1.0);
+
+    if (cfg.workload == "sequential") {
+        for (size_t i = 0; i < cfg.keys; ++i) w.build.push_back((int)i);
+        int next = (int)cfg.keys;
+        for (size_t i = 0; i < cfg.ops; ++i) {
+            bool read = coin(rng) < cfg.read_ratio;
+            w.read.push_back(read);
+            w.keys.push_back(read ? (int)(rng() % next) : next++);
+        }
+    }
+    else if (cfg.workload == "zipf") {
+        Zipf zipf(cfg.keys * 2);
+        for (size_t i = 0; i < cfg.keys; ++i) w.build.push_back(scramble(zipf(rng)));
+        for (size_t i = 0; i < cfg.ops; ++i) {
+            w.read.push_back(coin(rng) < cfg.read_ratio);
+            w.keys.push_back(scramble(zipf(rng)));
+        }
+    }
+    else {
+        for (size_t i = 0; i < cfg.keys; ++i) w.build.push_back(any(rng));
+        for (size_t i = 0; i < cfg.ops; ++i) {
+            bool read = coin(rng) < cfg.read_ratio;
+            w.read.push_back(read);
+            w.keys.push_back(read ? w.build[rng() % w.build.size()] : any(rng));
+        }
+    }
+    w.distinct = unordered_set<int>(w.build.begin(), w.build.end()).size();
+    return w;
+}
+
+static Workload<string> make_words(const Config& cfg) {
+    Workload<string> w;
+    vector<string> words;
+    ifstream in(cfg.words);
+    for (string s; in >> s;) words.push_back(s);
+    if (words.empty()) {
+        cerr << "no words read from '" << cfg.words << "'\n";
+        exit(1);
+    }
+
+    // builds from a random sample of the list, then reads follow a Zipf law
+    // over the whole list and writes add the remaining words
+    mt19937_64 rng(cfg.seed);
+    shuffle(words.begin(), words.end(), rng);
+    size_t n = min(cfg.keys, words.size());
+    w.build.assign(words.begin(), words.begin() + n);
+
+    Zipf zipf(words.size());
+    uniform_real_distribution<double> coin(0.0, 1.0);
+    for (size_t i = 0; i < cfg.ops; ++i) {
+        bool read = coin(rng) < cfg.read_ratio;
+        w.read.push_back(read);
+        w.keys.push_back(read ? words[zipf(rng)] : words[rng() % words.size()]);
+    }
+    w.distinct = unordered_set<string>(w.build.begin(), w.build.end()).size();
+    return w;
+}
+
+static Workload<string> to_strings(const Workload<int>& w) {
+    Workload<string> s;
+    for (int k : w.build) s.build.push_back(to_string(k));
+    for (int k : w.keys) s.keys.push_back(to_string(k));
+    s.read = w.read;
+    s.distinct = w.distinct;
+    return s;
+}
+
+// uniform lookup over the structures' different search signatures
+template<typename S, typename K> bool contains(S& s, const K& k) { return s.search(k); }
+template<typename K> bool contains(set<K>& s, const K& k) { return s.count(k) > 0; }
+template<typename K> bool contains(unordered_set<K>& s, const K& k) { return s.count(k) > 0; }
+bool contains(legacy::BTree& s, const int& k) { return s.search(k) != NULL; }
+
+static double percentile(vector<uint32_t>& v, double p) {
+    if (v.empty()) return 0;
+    size_t i = min(v.size() - 1, (size_t)(p * (double)v.size()));
+    nth_element(v.begin(), v.begin() + i, v.end());
+    return v[i];
+}
+
+template<typename S, typename K, typename Make>
+void run(const Config& cfg, const string& name, const Workload<K>& w, Make make, bool& first) {
+    if (!cfg.only.empty() && cfg.only != name) return;
+    using clock = chrono::steady_clock;
+
+    size_t before = live_bytes;
+    unique_ptr<S> s = make();
+    auto start = clock::now();
+    for (const K& k : w.build) s->insert(k);
+    double build_ns = chrono::duration<double, nano>(clock::now() - start).count();
+    size_t bytes = live_bytes - before;
+
+    // mixed phase, once for throughput and once more for per-op latencies,
+    // the second time on a structure built anew so that it runs the same
+    // mix and its inserts are not all duplicates
+    size_t hits = 0;
+    start = clock::now();
+    for (size_t i = 0; i < w.keys.size(); ++i) {
+        if (w.read[i]) hits += contains(*s, w.keys[i]);
+        else s->insert(w.keys[i]);
+    }
+    double mixed_ns = chrono::duration<double, nano>(clock::now() - start).count();
+
+    unique_ptr<S> fresh = make();
+    for (const K& k : w.build) fresh->insert(k);
+    vector<uint32_t> latency;
+    latency.reserve(w.keys.size());
+    size_t found = 0; // kept only so the searches are not optimized away
+    for (size_t i = 0; i < w.keys.size(); ++i) {
+        auto t0 = clock::now();
+        if (w.read[i]) found += contains(*fresh, w.keys[i]);
+        else fresh->insert(w.keys[i]);
+        latency.push_back((uint32_t)chrono::duration_cast<chrono::nanoseconds>(clock::now() - t0).count());
+    }
+    if (found != hits) cerr << name << ": latency pass found " << found << " keys, expected " << hits << '\n';
+
+    double ops = (double)max<size_t>(1, w.keys.size());
+    cout << (first ? "" : ",\n") << "  {"
+         << "\"structure\": \"" << name << "\", "
+         << "\"workload\": \"" << cfg.workload << "\", "
+         << "\"keys\": " << w.build.size() << ", "
+         << "\"distinct_keys\": " << w.distinct << ", "
+         << "\"ops\": " << w.keys.size() << ", "
+         << "\"read_ratio\": " << cfg.read_ratio << ", "
+         << "\"t\": " << cfg.t << ", "
+         << "\"build_ns_per_key\": " << build_ns / (double)max<size_t>(1, w.build.size()) << ", "
+         << "\"ns_per_op\": " << mixed_ns / ops << ", "
+         << "\"ops_per_sec\": " << ops * 1e9 / mixed_ns << ", "
+         << "\"bytes_per_key\": " << (double)bytes / (double)max<size_t>(1, w.distinct) << ", "
+         << "\"p50_ns\": " << percentile(latency, 0.50) << ", "
+         << "\"p99_ns\": " << percentile(latency, 0.99) << ", "
+         << "\"p999_ns\": " << percentile(latency, 0.999) << ", "
+         << "\"hits\": " << hits << "}";
+    first = false;
+    cout.flush();
+
+    // bplustree.h's BTree has no destructor and cannot tear itself down
+    // safely, so it alone is leaked; the rest give their memory back here
+    if constexpr (is_same<S, legacy::BTree>::value) {
+        s.release();
+        fresh.release();
+    }
+}
+
+int main(int argc, char** argv) {
+    Config cfg;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string opt = argv[i], val = argv[i + 1];
+        if (opt == "--workload") cfg.workload = val;
+        else if (opt == "--words") cfg.words = val;
+        else if (opt == "--only") cfg.only = val;
+        else if (opt == "--keys") cfg.keys = stoull(val);
+        else if (opt == "--ops") cfg.ops = stoull(val);
+        else if (opt == "--read-ratio") cfg.read_ratio = stod(val);
+        else if (opt == "--t") cfg.t = stoi(val);
+        else if (opt == "--seed") cfg.seed = stoull(val);
+        else {
+            cerr << "unknown option " << opt << '\n';
+            return 1;
+        }
+    }
+    int t = cfg.t;
+    bool first = true;
+    cout << "[\n";
+
+    if (cfg.workload == "words") {
+        Workload<string> w = make_words(cfg);
+        run<Trie>(cfg, "Trie", w, [] { return make_unique<Trie>(); }, first);
+        run<BurstTrie>(cfg, "BurstTrie", w, [] { return make_unique<BurstTrie>(); }, first);
+        run<BTree<string>>(cfg, "BTree", w, [t] { return make_unique<BTree<string>>(t); }, first);
+        run<BPlus<string>>(cfg, "BPlus", w, [t] { return make_unique<BPlus<string>>(t); }, first);
+        run<BPlus<string, NoStats, PoolAllocator<string>>>(cfg, "BPlus+pool", w, [t] { return make_unique<BPlus<string, NoStats, PoolAllocator<string>>>(t); }, first);
+        run<SnapshotBPlus<string>>(cfg, "SnapshotBPlus", w, [t] { return make_unique<SnapshotBPlus<string>>(t); }, first);
+        run<set<string>>(cfg, "std::set", w, [] { return make_unique<set<string>>(); }, first);
+        run<unordered_set<string>>(cfg, "std::unordered_set", w, [] { return make_unique<unordered_set<string>>(); }, first);
+    }
+    else {
+        Workload<int> w = make_ints(cfg);
+        run<BTree<int>>(cfg, "BTree", w, [t] { return make_unique<BTree<int>>(t); }, first);
+        run<BPlus<int>>(cfg, "BPlus", w, [t] { return make_unique<BPlus<int>>(t); }, first);
+        run<BPlus<int, NoStats, PoolAllocator<int>>>(cfg, "BPlus+pool", w, [t] { return make_unique<BPlus<int, NoStats, PoolAllocator<int>>>(t); }, first);
+        run<ConcurrentBPlus<int>>(cfg, "ConcurrentBPlus", w, [t] { return make_unique<ConcurrentBPlus<int>>(t); }, first);
+        run<SnapshotBPlus<int>>(cfg, "SnapshotBPlus", w, [t] { return make_unique<SnapshotBPlus<int>>(t); }, first);
+        run<PackedBPlus<int>>(cfg, "PackedBPlus", w, [t] { return make_unique<PackedBPlus<int>>(t); }, first);
+        run<legacy::BTree>(cfg, "bplustree.h BTree", w, [t] { return make_unique<legacy::BTree>(t); }, first);
+        run<BETree>(cfg, "BETree", w, [t] { return make_unique<BETree>(t); }, first);
+        run<set<int>>(cfg, "std::set", w, [] { return make_unique<set<int>>(); }, first);
+        run<unordered_set<int>>(cfg, "std::unordered_set", w, [] { return make_unique<unordered_set<int>>(); }, first);
+        Workload<string> ws = to_strings(w);
+        run<Trie>(cfg, "Trie", ws, [] { return make_unique<Trie>(); }, first);
+        run<BurstTrie>(cfg, "BurstTrie", ws, [] { return make_unique<BurstTrie>(); }, first);
+    }
+
+    cout << "\n]\n";
+    return 0;
+}
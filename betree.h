@@ -0,0 +1,335 @@
+#ifndef BETREE_H
+#define BETREE_H
+
+#include <iostream>
+#include <algorithm>
+#include <vector>
+using namespace std;
+
+// A pending insert or delete, buffered in an internal node until it is
+// flushed down to the leaf that owns its key
+struct BEMessage
+{
+	int key;
+	bool insert; // True for an insertion, false for a deletion
+};
+
+// A Bε-tree node. Leaves hold keys, internal nodes hold pivots, child
+// pointers and a buffer of messages for their subtree
+class BETreeNode
+{
+	vector<int> keys;			   // Keys of a leaf, or pivots of an internal node
+	vector<BETreeNode *> children; // Child pointers, empty in leaves
+	vector<BEMessage> buffer;	   // Pending messages sorted by key, internal nodes only
+	bool isLeaf;				   // Is true when node is leaf. Otherwise false
+
+public:
+	BETreeNode(bool _leaf); // Constructor
+
+	~BETreeNode();
+
+	// A node owns its children, so it cannot be copied
+	BETreeNode(const BETreeNode &) = delete;
+	BETreeNode &operator=(const BETreeNode &) = delete;
+
+	// A function that returns the index of the child whose range holds k.
+	// Child i holds the keys in [keys[i-1], keys[i])
+	int findChild(int k);
+
+	// A function to add the sorted messages [first, last), which are newer
+	// than anything below this node. A leaf applies them to its keys, an
+	// internal node merges them into its buffer
+	void addMessages(vector<BEMessage>::iterator first, vector<BEMessage>::iterator last);
+
+	friend class BETree;
+};
+
+// A write-optimized variant of BTree: inserts and deletes are queued as
+// messages in the root's buffer and move down in batches, so each leaf
+// write is paid for by many operations instead of one. Deletes never merge
+// nodes, a leaf just loses keys
+class BETree
+{
+	BETreeNode *root; // Pointer to root node
+	int t;			  // Minimum degree
+	int bufferSize;	  // Messages an internal node holds before flushing
+
+	// A function to check whether node x holds more than a node may
+	bool overfull(BETreeNode *x);
+
+	// A function to send a message down from the root
+	void upsert(BEMessage m);
+
+	// A function to empty the buffer of x into its children in one pass,
+	// flushing and splitting the children that overflow as a result
+	void flush(BETreeNode *x);
+
+	// A function to split the overfull child x->children[i] into as many
+	// nodes as it needs
+	void splitChild(BETreeNode *x, int i);
+
+	// A function to print the keys of the subtree x, applying the messages
+	// still pending above it
+	void traverse(BETreeNode *x, vector<BEMessage> pending);
+
+public:
+	// Constructor (Initializes tree as empty)
+	BETree(int _t, int _bufferSize = 0)
+	{
+		root = NULL;
+		t = _t;
+		bufferSize = (_bufferSize > 0 ? _bufferSize : 64 * t);
+	}
+
+	~BETree()
+	{
+		delete root;
+	}
+
+	// The tree owns its nodes, so it cannot be copied
+	BETree(const BETree &) = delete;
+	BETree &operator=(const BETree &) = delete;
+
+	void traverse()
+	{
+		if (root != NULL)
+			traverse(root, vector<BEMessage>());
+	}
+
+	// function to search a key in this tree
+	bool search(int k);
+
+	// The main function that inserts a new key in this tree
+	void insert(int k)
+	{
+		upsert({k, true});
+	}
+
+	// The main function that removes a key from this tree
+	void remove(int k)
+	{
+		upsert({k, false});
+	}
+};
+
+BETreeNode::BETreeNode(bool _leaf)
+{
+	isLeaf = _leaf;
+}
+
+BETreeNode::~BETreeNode()
+{
+	for (BETreeNode *c : children)
+		delete c;
+}
+
+int BETreeNode::findChild(int k)
+{
+	return upper_bound(keys.begin(), keys.end(), k) - keys.begin();
+}
+
+void BETreeNode::addMessages(vector<BEMessage>::iterator first, vector<BEMessage>::iterator last)
+{
+	if (isLeaf)
+	{
+		// Merge keys and messages in one pass, a message replaces the key
+		vector<int> merged;
+		merged.reserve(keys.size() + (last - first));
+		size_t i = 0;
+		for (; first != last; ++first)
+		{
+			while (i < keys.size() && keys[i] < first->key)
+				merged.push_back(keys[i++]);
+			if (i < keys.size() && keys[i] == first->key)
+				++i;
+			if (first->insert)
+				merged.push_back(first->key);
+		}
+		while (i < keys.size())
+			merged.push_back(keys[i++]);
+		keys.swap(merged);
+		return;
+	}
+
+	// Merge both sorted runs, an incoming message replaces a buffered one
+	// for the same key since it is newer
+	vector<BEMessage> merged;
+	merged.reserve(buffer.size() + (last - first));
+	size_t i = 0;
+	for (; first != last; ++first)
+	{
+		while (i < buffer.size() && buffer[i].key < first->key)
+			merged.push_back(buffer[i++]);
+		if (i < buffer.size() && buffer[i].key == first->key)
+			++i;
+		merged.push_back(*first);
+	}
+	while (i < buffer.size())
+		merged.push_back(buffer[i++]);
+	buffer.swap(merged);
+}
+
+bool BETree::overfull(BETreeNode *x)
+{
+	if (x->isLeaf)
+		return (int)x->keys.size() > 2 * t - 1;
+	return (int)x->children.size() > 2 * t;
+}
+
+void BETree::upsert(BEMessage m)
+{
+	if (root == NULL)
+		root = new BETreeNode(true);
+
+	if (root->isLeaf)
+	{
+		vector<BEMessage> one(1, m);
+		root->addMessages(one.begin(), one.end());
+	}
+	else
+	{
+		// A single message goes in place instead of rebuilding the buffer
+		auto it = lower_bound(root->buffer.begin(), root->buffer.end(), m.key,
+							  [](const BEMessage &a, int key)
+							  { return a.key < key; });
+		if (it != root->buffer.end() && it->key == m.key)
+			*it = m;
+		else
+			root->buffer.insert(it, m);
+		if ((int)root->buffer.size() > bufferSize)
+			flush(root);
+	}
+
+	// Grow the tree while the root holds too much
+	while (overfull(root))
+	{
+		BETreeNode *s = new BETreeNode(false);
+		s->children.push_back(root);
+		root = s;
+		splitChild(s, 0);
+	}
+}
+
+void BETree::flush(BETreeNode *x)
+{
+	// The buffer is sorted, so each child's messages are a contiguous run
+	int from = 0;
+	for (int i = 0; i < (int)x->children.size(); ++i)
+	{
+		int to = from;
+		while (to < (int)x->buffer.size() && (i == (int)x->keys.size() || x->buffer[to].key < x->keys[i]))
+			++to;
+		if (to > from)
+			x->children[i]->addMessages(x->buffer.begin() + from, x->buffer.begin() + to);
+		from = to;
+	}
+	x->buffer.clear();
+
+	// Right to left, so splits do not shift the children still to visit
+	for (int i = (int)x->children.size() - 1; i >= 0; --i)
+	{
+		BETreeNode *c = x->children[i];
+		if (!c->isLeaf && (int)c->buffer.size() > bufferSize)
+			flush(c);
+		if (overfull(c))
+			splitChild(x, i);
+	}
+}
+
+void BETree::splitChild(BETreeNode *x, int i)
+{
+	BETreeNode *y = x->children[i];
+
+	// Items to distribute are keys in a leaf and children otherwise
+	int cap = (y->isLeaf ? 2 * t - 1 : 2 * t);
+	int total = (int)(y->isLeaf ? y->keys.size() : y->children.size());
+	int pieces = (total + cap - 1) / cap;
+
+	vector<int> keys;
+	vector<BETreeNode *> children;
+	vector<BEMessage> buffer;
+	keys.swap(y->keys);
+	children.swap(y->children);
+	buffer.swap(y->buffer);
+
+	vector<int> pivots;
+	vector<BETreeNode *> nodes;
+	int from = 0, msg = 0;
+	for (int j = 0; j < pieces; ++j)
+	{
+		int to = from + total / pieces + (j < total % pieces);
+		BETreeNode *z = (j == 0 ? y : new BETreeNode(y->isLeaf));
+		if (y->isLeaf)
+		{
+			if (j > 0)
+				pivots.push_back(keys[from]);
+			z->keys.assign(keys.begin() + from, keys.begin() + to);
+		}
+		else
+		{
+			// The pivot between two pieces moves up to x
+			if (j > 0)
+				pivots.push_back(keys[from - 1]);
+			z->children.assign(children.begin() + from, children.begin() + to);
+			z->keys.assign(keys.begin() + from, keys.begin() + to - 1);
+
+			int end = msg;
+			while (end < (int)buffer.size() && (to == total || buffer[end].key < keys[to - 1]))
+				++end;
+			z->buffer.assign(buffer.begin() + msg, buffer.begin() + end);
+			msg = end;
+		}
+		nodes.push_back(z);
+		from = to;
+	}
+
+	x->keys.insert(x->keys.begin() + i, pivots.begin(), pivots.end());
+	x->children.insert(x->children.begin() + i + 1, nodes.begin() + 1, nodes.end());
+}
+
+bool BETree::search(int k)
+{
+	BETreeNode *cur = root;
+	while (cur != NULL && !cur->isLeaf)
+	{
+		// The message closest to the root is the newest one
+		auto it = lower_bound(cur->buffer.begin(), cur->buffer.end(), k,
+							  [](const BEMessage &m, int key)
+							  { return m.key < key; });
+		if (it != cur->buffer.end() && it->key == k)
+			return it->insert;
+		cur = cur->children[cur->findChild(k)];
+	}
+	return cur != NULL && binary_search(cur->keys.begin(), cur->keys.end(), k);
+}
+
+void BETree::traverse(BETreeNode *x, vector<BEMessage> pending)
+{
+	if (x->isLeaf)
+	{
+		// Apply the pending messages to a copy of the leaf's keys
+		BETreeNode leaf(true);
+		leaf.keys = x->keys;
+		leaf.addMessages(pending.begin(), pending.end());
+		for (int k : leaf.keys)
+			cout << " " << k;
+		return;
+	}
+
+	// Pending messages from above are newer than the ones buffered here
+	BETreeNode merged(false);
+	merged.buffer = x->buffer;
+	merged.addMessages(pending.begin(), pending.end());
+
+	size_t from = 0;
+	for (int i = 0; i < (int)x->children.size(); ++i)
+	{
+		size_t to = from;
+		while (to < merged.buffer.size() && (i == (int)x->keys.size() || merged.buffer[to].key < x->keys[i]))
+			++to;
+		traverse(x->children[i], vector<BEMessage>(merged.buffer.begin() + from, merged.buffer.begin() + to));
+		from = to;
+	}
+}
+
+#endif // BETREE_H
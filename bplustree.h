@@ -79,12 +79,31 @@ class BTree
 {
 	BTreeNode *root; // Pointer to root node
 	int t;			 // Minimum degree
+
+	// Leaf that received the last insertion, and the keys bounding the range
+	// of keys that belong to it (a missing bound means unbounded)
+	BTreeNode *finger;
+	int fingerLo, fingerHi;
+	bool hasLo, hasHi;
+
+	// A function to point the finger at the leaf whose range holds k
+	void setFinger(int k);
+
+	// A function to split the full node y through its parent pointer,
+	// splitting full ancestors first. Returns the index of y in its parent
+	int splitUp(BTreeNode *y);
+
+	// A function to check the subtree rooted with x, whose parent is p and
+	// whose keys lie between the given bounds
+	bool valid(BTreeNode *x, BTreeNode *p, bool hasLo, int lo, bool hasHi, int hi);
+
 public:
 	// Constructor (Initializes tree as empty)
 	BTree(int _t)
 	{
 		root = NULL;
 		t = _t;
+		finger = NULL;
 	}
 
 	void traverse()
@@ -104,11 +123,21 @@ public:
 		return root;
 	}
 
-	// The main function that inserts a new key in this B-Tree
+	// The main function that inserts a new key in this B-Tree. Keys that
+	// belong to the same leaf as the previous insertion skip the descent
 	void insert(int k);
 
 	// The main function that removes a new key in this B-Tree
 	void remove(int k);
+
+	// A function to check that keys are sorted within the bounds set by
+	// their ancestors, that every node holds t - 1 to 2t - 1 keys (the root
+	// 1 or more), that all leaves are at the same depth and that every
+	// child points back at its parent
+	bool valid()
+	{
+		return root == NULL || valid(root, NULL, false, 0, false, 0);
+	}
 };
 
 BTreeNode::BTreeNode(int t1, bool leaf1, BTreeNode *p = NULL)
@@ -293,7 +322,10 @@ void BTreeNode::borrowFromPrev(int idx)
 
 	// Moving sibling's last child as C[idx]'s first child
 	if (!child->isLeaf)
+	{
 		child->children[0] = sibling->children[sibling->keyNo];
+		child->children[0]->parent = child;
+	}
 
 	// Moving the key from the sibling to the parent
 	// This reduces the number of keys in the sibling
@@ -319,7 +351,10 @@ void BTreeNode::borrowFromNext(int idx)
 	// Sibling's first child is inserted as the last child
 	// into C[idx]
 	if (!(child->isLeaf))
+	{
 		child->children[(child->keyNo) + 1] = sibling->children[0];
+		child->children[(child->keyNo) + 1]->parent = child;
+	}
 
 	// The first key from sibling is inserted into keys[idx]
 	keys[idx] = sibling->keys[0];
@@ -362,7 +397,10 @@ void BTreeNode::merge(int idx)
 	if (!child->isLeaf)
 	{
 		for (int i = 0; i <= sibling->keyNo; ++i)
+		{
 			child->children[i + t] = sibling->children[i];
+			child->children[i + t]->parent = child;
+		}
 	}
 
 	// Moving all keys after idx in the current node one step before -
@@ -387,6 +425,33 @@ void BTreeNode::merge(int idx)
 // The main function that inserts a new key in this B-Tree
 void BTree::insert(int k)
 {
+	// Keys arriving in order mostly belong to the leaf that took the
+	// previous one: insert there directly and split bottom-up when it is full
+	if (finger != NULL && (!hasLo || k > fingerLo) && (!hasHi || k < fingerHi))
+	{
+		if (finger->keyNo == 2 * t - 1)
+		{
+			int i = splitUp(finger);
+			BTreeNode *p = finger->parent;
+
+			// The middle key of the finger went up to p and now bounds
+			// one of the two halves
+			if (k > p->keys[i])
+			{
+				finger = p->children[i + 1];
+				hasLo = true;
+				fingerLo = p->keys[i];
+			}
+			else
+			{
+				hasHi = true;
+				fingerHi = p->keys[i];
+			}
+		}
+		finger->insertNonFull(k);
+		return;
+	}
+
 	if (root == NULL)
 		root = new BTreeNode(t, true);
 	else if (root->keyNo == (t << 1) - 1)
@@ -399,6 +464,97 @@ void BTree::insert(int k)
 		s->splitChild(0, s->children[0]);
 	}
 	root->insertNonFull(k);
+	setFinger(k);
+}
+
+// A function to point the finger at the leaf whose range holds k, the
+// bounds are the closest keys on each side met on the way down
+void BTree::setFinger(int k)
+{
+	hasLo = hasHi = false;
+	BTreeNode *cur = root;
+	while (!cur->isLeaf)
+	{
+		int i = cur->findKey(k);
+		if (i < cur->keyNo && cur->keys[i] == k)
+		{
+			// k sits in an internal node, no leaf owns it
+			finger = NULL;
+			return;
+		}
+		if (i > 0)
+		{
+			hasLo = true;
+			fingerLo = cur->keys[i - 1];
+		}
+		if (i < cur->keyNo)
+		{
+			hasHi = true;
+			fingerHi = cur->keys[i];
+		}
+		cur = cur->children[i];
+	}
+	finger = cur;
+}
+
+// A function to split the full node y through its parent pointer. A full
+// parent is split first, which may move y under the parent's new sibling
+int BTree::splitUp(BTreeNode *y)
+{
+	BTreeNode *p = y->parent;
+	if (p == NULL)
+	{
+		p = new BTreeNode(t, false);
+		p->children[0] = y;
+		y->parent = p;
+		root = p;
+	}
+	else if (p->keyNo == 2 * t - 1)
+	{
+		splitUp(p);
+		p = y->parent;
+	}
+
+	int i = 0;
+	while (p->children[i] != y)
+		++i;
+	p->splitChild(i, y);
+	return i;
+}
+
+bool BTree::valid(BTreeNode *x, BTreeNode *p, bool hasLo, int lo, bool hasHi, int hi)
+{
+	if (x->parent != p)
+		return false;
+	if (x->keyNo > 2 * t - 1 || x->keyNo < (p == NULL ? 1 : t - 1))
+		return false;
+	for (int i = 0; i < x->keyNo; ++i)
+	{
+		if (i > 0 && !(x->keys[i - 1] < x->keys[i]))
+			return false;
+		if ((hasLo && !(lo < x->keys[i])) || (hasHi && !(x->keys[i] < hi)))
+			return false;
+	}
+	if (x->isLeaf)
+		return true;
+
+	// every subtree of x must be as deep as the first one
+	int depth = 0;
+	for (BTreeNode *c = x->children[0]; !c->isLeaf; c = c->children[0])
+		++depth;
+	for (int i = 0; i <= x->keyNo; ++i)
+	{
+		int d = 0;
+		for (BTreeNode *c = x->children[i]; !c->isLeaf; c = c->children[0])
+			++d;
+		if (d != depth)
+			return false;
+		bool childHasLo = (i > 0) || hasLo, childHasHi = (i < x->keyNo) || hasHi;
+		int childLo = (i > 0 ? x->keys[i - 1] : lo), childHi = (i < x->keyNo ? x->keys[i] : hi);
+		if (!valid(x->children[i], x, childHasLo, childLo, childHasHi, childHi))
+			return false;
+	}
+	return true;
 }
 
 // A utility function to insert a new key in this node
@@ -453,7 +609,7 @@ void BTreeNode::splitChild(int i, BTreeNode *y)
 {
 	// Create a new node which is going to store (t-1) keys
 	// of y
-	BTreeNode *z = new BTreeNode(y->t, y->isLeaf, y->parent);
+	BTreeNode *z = new BTreeNode(y->t, y->isLeaf, this);
 	z->keyNo = t - 1;
 
 	// Copy the last (t-1) keys of y to z
@@ -464,7 +620,10 @@ void BTreeNode::splitChild(int i, BTreeNode *y)
 	if (y->isLeaf == false)
 	{
 		for (int j = 0; j < t; j++)
+		{
 			z->children[j] = y->children[j + t];
+			z->children[j]->parent = z;
+		}
 	}
 
 	// Reduce the number of keys in y
@@ -513,7 +672,7 @@ BTreeNode *BTreeNode::search(int k)
 		if (k <= keys[i])
 			break;
 
-	if (keys[i] == k)
+	if (i < keyNo && keys[i] == k)
 		return this;
 
 	if (isLeaf)
@@ -526,6 +685,9 @@ void BTree::remove(int k)
 {
 	if (root == NULL)
 		return;
+
+	// Merges may free the finger's leaf
+	finger = NULL;
 	root->remove(k);
 }
 
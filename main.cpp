@@ -1,7 +1,25 @@
 #include <iostream>
 #include "Trie.h"
+#include "TrieIngest.h"
+#include "MultibitTrie.h"
+#include "BurstTrie.h"
 #include "BPlus.h"
+#include "BTree.h"
+#include "ConcurrentBPlus.h"
+#include "SnapshotBPlus.h"
+#include "PackedBPlus.h"
+#include "Pool.h"
+#include "Trace.h"
+#include "betree.h"
+#include <atomic>
 #include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <memory_resource>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <vector>
 using namespace std;
 
 // TRIE
@@ -32,6 +50,96 @@ void test_erase() {
     assert(trie.search("a") == false);
 }
 
+void test_intern() {
+    Trie trie;
+    vector<int> ids = trie.encode({"pear", "apple", "fig", "apple", "app"});
+    assert(ids == vector<int>({3, 1, 2, 1, 0}));
+    assert(trie.size() == 4);
+    assert(trie.id_of("fig") == 2);
+    assert(trie.id_of("ap") == -1);
+    assert(trie.string_of(1) == "apple");
+    assert(trie.string_of(4) == "");
+
+    trie.erase("app"); // ids after it shift down
+    assert(trie.id_of("apple") == 0);
+    assert(trie.string_of(2) == "pear");
+}
+
+void test_ingest() {
+    const string path = "ingest_test.txt";
+    {
+        ofstream out(path);
+        for (int i = 0; i < 50000; ++i) out << "w" << i % 1000 << (i % 7 ? ' ' : '\n');
+    }
+    Trie trie;
+    trie.insert("w5");
+    trie.insert("zz");
+    ingest(trie, {path, path}, 3);
+    remove(path.c_str());
+    assert(trie.size() == 1001);
+    assert(trie.search("w999") == true);
+    assert(trie.search("w1000") == false);
+    assert(trie.id_of("w0") == 0);
+    assert(trie.string_of(1000) == "zz");
+
+    string text = " \tab  cd\ne ";
+    vector<string> words;
+    tokenize(text.data(), text.data() + text.size(), " \t\n", [&](const char* s, size_t n) { words.emplace_back(s, n); });
+    assert(words == vector<string>({"ab", "cd", "e"}));
+}
+
+void test_longest_prefix_match() {
+    Trie trie;
+    trie.insert("/");
+    trie.insert("/api");
+    trie.insert("/api/v2");
+    assert(trie.longest_prefix_match("/api/v2/users") == "/api/v2");
+    assert(trie.longest_prefix_match("/apx") == "/");
+    assert(trie.longest_prefix_match("api") == "");
+
+    MultibitTrie<int> routes;
+    unsigned char net[4] = {10, 1, 2, 128};
+    routes.insert(net, 0, 0); // default route
+    routes.insert(net, 8, 1); // 10.0.0.0/8
+    routes.insert(net, 16, 2); // 10.1.0.0/16
+    routes.insert(net, 23, 3); // 10.1.2.0/23
+    routes.insert(net, 25, 4); // 10.1.2.128/25
+    unsigned char a[4] = {10, 1, 3, 7}, b[4] = {10, 1, 2, 200}, c[4] = {10, 9, 9, 9}, d[4] = {11, 0, 0, 1};
+    assert(*routes.match(a, 4) == 3);
+    assert(*routes.match(b, 4) == 4);
+    assert(*routes.match(c, 4) == 1);
+    assert(*routes.match(d, 4) == 0);
+    assert(routes.erase(net, 23) == true);
+    assert(*routes.match(a, 4) == 2);
+    assert(routes.size() == 4);
+
+    MultibitTrie<string> paths;
+    paths.insert("/api", "api");
+    assert(*paths.match("/api/users") == "api");
+    assert(paths.match("/ap") == nullptr);
+}
+
+void test_minimize() {
+    Trie trie;
+    vector<string> stems = {"walk", "talk", "jump", "play", "work"};
+    for (const string& stem : stems)
+        for (const char* suffix : {"", "s", "ed", "ing", "er"})
+            trie.insert(stem + suffix);
+    int ids = trie.id_of("played");
+    int before = trie.nodes();
+    trie.minimize();
+    assert(trie.nodes() * 2 < before);
+    assert(trie.search("talking") == true);
+    assert(trie.search("talkin") == false);
+    assert(trie.id_of("played") == ids);
+    assert(trie.string_of(ids) == "played");
+
+    trie.insert("walkers"); // back to a tree first
+    assert(trie.search("walkers") == true);
+    assert(trie.search("worker") == true);
+    assert(trie.size() == 26);
+}
+
 // BPlus
 void test() {
     BPlus<char> bt (3);
@@ -50,9 +158,569 @@ void test() {
     assert(bt.search('c') == false);
 }
 
+void test_strings() {
+    BPlus<string> bt (2);
+    vector<string> urls = {"https://a.com/x", "https://a.com/xy", "https://a.com/y", "https://b.org",
+                           "https://a.com/", "https://a.com/xz", "https://a.com/x/1", "https://a.com/x/2"};
+    for (const string& u : urls) bt.insert(u);
+    bt.erase("https://a.com/xy");
+    assert(bt.search("https://a.com/x") == true);
+    assert(bt.search("https://a.com/xy") == false);
+    assert(bt.search("https://a.com") == false);
+
+    string last;
+    bt.traverse([&last](const string& k)->void{ assert(last < k); last = k; });
+    assert(last == "https://b.org");
+}
+
+void test_insert_batch() {
+    BPlus<int> bt (2);
+    bt.insert(5);
+    bt.insert(50);
+    vector<int> batch;
+    for (int i = 0; i < 100; i += 2) batch.push_back(i);
+    bt.insert_batch(batch);
+
+    int expected = 0, count = 0;
+    bt.traverse([&](int k)->void{
+        assert(k == expected || k == 5);
+        if (k != 5) expected += 2;
+        count += 1;
+    });
+    assert(count == 51);
+    assert(bt.search(5) == true);
+    assert(bt.search(98) == true);
+    assert(bt.search(99) == false);
+}
+
+void test_erase_range() {
+    BPlus<int> bt (2);
+    for (int i = 0; i < 1000; ++i) bt.insert(i);
+    bt.erase_range(100, 900);
+    bt.erase_range(950, 2000);
+    bt.erase_range(40, 41);
+    int expected = 0, count = 0;
+    bt.traverse([&](int k)->void{
+        if (expected == 40) expected = 41;
+        if (expected == 100) expected = 900;
+        assert(k == expected);
+        expected += 1;
+        count += 1;
+    });
+    assert(count == 149);
+    assert(bt.search(99) == true);
+    assert(bt.search(100) == false);
+    assert(bt.search(899) == false);
+    assert(bt.search(900) == true);
+
+    bt.insert(500); // still a working tree
+    bt.erase_range(-5, 949);
+    count = 0;
+    bt.traverse([&](int k)->void{ assert(k == 949); count += 1; });
+    assert(count == 1);
+}
+
+void test_set_operations() {
+    BPlus<int> a (2), b (3), c (2);
+    for (int i = 0; i < 300; i += 2) a.insert(i); // even
+    for (int i = 0; i < 300; i += 3) b.insert(i); // multiples of 3
+
+    auto check = [](BPlus<int>& bt, auto member) {
+        int expected = 0;
+        bt.traverse([&](int k)->void{
+            while (!member(expected)) expected += 1;
+            assert(k == expected);
+            expected += 1;
+        });
+        while (expected < 300 && !member(expected)) expected += 1;
+        assert(expected >= 300);
+    };
+    c.set_union(a, b);
+    check(c, [](int k) { return k % 2 == 0 || k % 3 == 0; });
+    c.set_intersection(a, b);
+    check(c, [](int k) { return k % 6 == 0; });
+    c.set_difference(a, b);
+    check(c, [](int k) { return k % 2 == 0 && k % 3 != 0; });
+    a.set_difference(a, c); // in place
+    check(a, [](int k) { return k % 6 == 0; });
+
+    BPlus<int> empty (2);
+    c.set_intersection(a, empty);
+    assert(c.search(0) == false);
+}
+
+void test_build() {
+    vector<int> sorted;
+    for (int i = 0; i < 20000; ++i) sorted.push_back(i / 2 * 2); // every even key twice
+    BPlus<int> bt (3);
+    bt.insert(-1); // replaced by the build
+    bt.build(sorted, 4);
+
+    assert(bt.search(-1) == false);
+    assert(bt.search(0) == true);
+    assert(bt.search(9998) == true);
+    assert(bt.search(9999) == false);
+
+    int count = 0;
+    bt.traverse([&count](int k)->void{ assert(k == count * 2); count += 1; });
+    assert(count == 10000);
+
+    for (int i = 0; i < 20000; i += 2) bt.erase(i);
+    bt.insert(7);
+    assert(bt.search(7) == true);
+    assert(bt.search(8) == false);
+}
+
+void test_load() {
+    vector<int> keys;
+    for (int i = 0; i < 600000; ++i) keys.push_back((int)((i * 7919LL) % 300000)); // every key twice, shuffled
+    string bytes ((const char*)keys.data(), keys.size() * sizeof(int));
+    istringstream in (bytes);
+
+    BPlus<int> bt (4);
+    bt.load(in, 1 << 20); // 2.4 MB of keys, sorted in three runs
+    int count = 0;
+    bt.traverse([&count](int k)->void{ assert(k == count); count += 1; });
+    assert(count == 300000);
+
+    for (int i = 0; i < 300000; i += 2) bt.erase(i);
+    assert(bt.search(1) == true);
+    assert(bt.search(2) == false);
+
+    istringstream cut (bytes.substr(0, bytes.size() - 1)); // last key cut short
+    bool threw = false;
+    try { bt.load(cut, 1 << 20); }
+    catch (const runtime_error&) { threw = true; }
+    assert(threw);
+    assert(bt.search(1) == false);
+}
+
+void test_save_restore() {
+    BPlus<int> bp (3);
+    for (int i = 0; i < 20000; ++i) bp.insert(i * 7919 % 20000 * 2);
+    stringstream file;
+    bp.save(file);
+
+    BTree<int> bt (5); // a tree of another kind and order restores it
+    bt.insert(-1);
+    bt.restore(file);
+    int count = 0;
+    bt.traverse([&count](int k)->void{ assert(k == count * 2); count += 1; });
+    assert(count == 20000);
+    bt.erase(0);
+    bt.insert(1);
+    assert(bt.search(1) && !bt.search(0) && bt.search(39998));
+
+    stringstream again;
+    bt.save(again);
+    string bytes = again.str();
+    BPlus<int> copy (4);
+    copy.restore(again);
+    assert(copy.search(1) && !copy.search(0) && copy.search(39998));
+
+    bytes[bytes.size() / 2] ^= 1; // damaged keys fail the checksum
+    istringstream bad (bytes);
+    bool threw = false;
+    try { copy.restore(bad); }
+    catch (const runtime_error&) { threw = true; }
+    assert(threw);
+    assert(copy.search(1) == false);
+
+    BTree<string> words (2);
+    for (const char* w : {"tree", "trie", "tries", "trip", "b", ""}) words.insert(w);
+    stringstream text;
+    words.save(text);
+    BPlus<string> restored (2);
+    restored.restore(text);
+    assert(restored.search("tries") && restored.search("") && !restored.search("tri"));
+
+    BTree<float> floats (2); // the same size as int, ordered otherwise
+    floats.insert(-1.5f);
+    floats.insert(2);
+    stringstream real;
+    floats.save(real);
+    bytes = real.str();
+    istringstream as_ints (bytes), as_naturals (bytes), as_floats (bytes);
+    BTree<int> ints (2);
+    threw = false;
+    try { ints.restore(as_ints); }
+    catch (const runtime_error&) { threw = true; }
+    assert(threw);
+    BTree<unsigned> naturals (2);
+    threw = false;
+    try { naturals.restore(as_naturals); }
+    catch (const runtime_error&) { threw = true; }
+    assert(threw);
+    BPlus<float> same (3);
+    same.restore(as_floats);
+    assert(same.search(-1.5f) && same.search(2));
+}
+
+void test_learn() {
+    BPlus<int64_t> bt (3);
+    for (int64_t i = 0; i < 3000; ++i) bt.insert(1000 + i * 5);
+    bt.learn(100);
+
+    assert(bt.search(1000) == true);
+    assert(bt.search(1005 + 5 * 1234) == true);
+    assert(bt.search(1001) == false);
+    assert(bt.search(-5) == false);
+    assert(bt.search(INT64_MAX) == false);
+
+    // writes move leaf boundaries, searches fall back to the tree until
+    // enough of them have accumulated to retrain
+    for (int64_t i = 0; i < 500; ++i) bt.insert(1002 + i * 5);
+    for (int64_t i = 0; i < 500; ++i) bt.erase(1000 + i * 10);
+    for (int64_t i = 0; i < 500; ++i) {
+        assert(bt.search(1002 + i * 5) == true);
+        assert(bt.search(1000 + i * 10) == false);
+        assert(bt.search(1005 + i * 10) == true);
+    }
+}
+
+void test_stats() {
+    BPlus<int, CountStats> bt (2);
+    for (int i = 0; i < 64; ++i) bt.insert(i);
+    const CountStats& stats = bt.statistics();
+    assert(stats.splits > 0);
+    assert(stats.allocations == stats.splits + stats.grows);
+    assert(stats.comparisons >= stats.visits - 64);
+
+    size_t visits = stats.visits;
+    assert(bt.search(10) == true);
+    assert(stats.visits > visits);
+
+    for (int i = 0; i < 64; ++i) bt.erase(i);
+    assert(stats.merges > 0);
+    assert(stats.borrows > 0);
+    assert(stats.shrinks == stats.grows);
+}
+
+// BTree
+void test_parallel() {
+    BTree<int> bt (3);
+    for (int i = 1; i <= 5000; ++i) bt.insert(i);
+
+    atomic<long long> sum {0};
+    bt.for_each([&sum](int k)->void{ sum += k; }, 4);
+    assert(sum == 5000LL * 5001 / 2);
+
+    long long total = bt.reduce(0LL, [](int k)->long long{ return k; }, plus<long long>(), 4);
+    assert(total == 5000LL * 5001 / 2);
+
+    // combine is not commutative, so this only holds if pieces merge in key order
+    struct Run { int lo, hi; bool sorted; };
+    Run run = bt.reduce(Run{0, 0, true}, [](int k)->Run{ return {k, k, true}; },
+                        [](Run a, Run b)->Run{ return {a.lo, b.hi, a.sorted && b.sorted && a.hi < b.lo}; }, 4);
+    assert(run.sorted && run.hi == 5000);
+}
+
+void test_freeze() {
+    BTree<int> bt (3);
+    for (int i = 0; i < 1000; ++i) bt.insert(i * 2);
+    FrozenTree<int> frozen = bt.freeze();
+
+    assert(frozen.size() == 1000);
+    assert(frozen.search(0) == true);
+    assert(frozen.search(1998) == true);
+    assert(frozen.search(7) == false);
+    assert(*frozen.lower_bound(7) == 8);
+    assert(frozen.lower_bound(1999) == frozen.end());
+    assert(*frozen.lower_bound(INT32_MIN) == 0);
+
+    int count = 0;
+    for (const int* p = frozen.lower_bound(100); p != frozen.end() && *p < 200; ++p) count += 1;
+    assert(count == 50);
+}
+
+void test_compact() {
+    BTree<int, CountStats> bt (4);
+    for (int i = 0; i < 10000; ++i) bt.insert(i * 7919 % 10000);
+    for (int i = 0; i < 10000; ++i)
+        if (i % 10 != 0) bt.erase(i);
+
+    size_t merges = bt.statistics().merges;
+    int slices = 1;
+    while (!bt.compact(8)) slices += 1;
+    assert(slices > 1);
+    assert(bt.statistics().merges > merges);
+
+    int expected = 0;
+    bt.traverse([&expected](int k)->void{ assert(k == expected); expected += 10; });
+    assert(expected == 10000);
+    assert(bt.search(500) == true);
+    assert(bt.search(501) == false);
+
+    for (int i = 1; i < 10000; i += 10) bt.insert(i);
+    bt.erase(0);
+    assert(bt.search(1) && bt.search(9991) && !bt.search(0));
+
+    bt.clear();
+    assert(bt.search(10) == false);
+    assert(bt.compact() == true);
+    bt.insert(3);
+    assert(bt.search(3) == true);
+}
+
+// Allocators
+void test_allocators() {
+    BPlus<string, NoStats, PoolAllocator<string>> pooled (2);
+    for (int i = 0; i < 500; ++i) pooled.insert("key" + to_string(i));
+    for (int i = 0; i < 500; i += 2) pooled.erase("key" + to_string(i));
+    assert(pooled.search("key1") == true);
+    assert(pooled.search("key2") == false);
+
+    // a thread that ends hands its blocks back to the shared pool
+    thread([] {
+        BTree<int, NoStats, PoolAllocator<int>> bt (3);
+        for (int i = 0; i < 200; ++i) bt.insert(i);
+        assert(bt.search(199) == true);
+    }).join();
+
+    char buffer[1 << 16];
+    pmr::monotonic_buffer_resource arena (buffer, sizeof(buffer));
+    BPlus<int, NoStats, pmr::polymorphic_allocator<int>> bt (3, &arena);
+    for (int i = 0; i < 300; ++i) bt.insert(i);
+    for (int i = 0; i < 300; i += 3) bt.erase(i);
+    int count = 0;
+    bt.traverse([&count](int k)->void{ assert(k % 3 != 0); count += 1; });
+    assert(count == 200);
+
+    // build allocates from the calling thread only, the arena is not thread-safe
+    vector<string> sorted;
+    for (int i = 0; i < 40000; ++i) sorted.push_back(to_string(100000 + i));
+    pmr::monotonic_buffer_resource heap_arena;
+    BPlus<string, NoStats, pmr::polymorphic_allocator<string>> built (3, &heap_arena);
+    built.build(sorted, 4);
+    assert(built.search("100000") && built.search("139999") && !built.search("140000"));
+    count = 0;
+    built.traverse([&count, &sorted](const string& k)->void{ assert(k == sorted[count]); count += 1; });
+    assert(count == 40000);
+}
+
+// ConcurrentBPlus
+void test_concurrent() {
+    ConcurrentBPlus<int> bt (3);
+    vector<thread> writers;
+    for (int w = 0; w < 4; ++w)
+        writers.emplace_back([&bt, w]() {
+            for (int i = w; i < 4000; i += 4) bt.insert(i);
+            for (int i = w; i < 4000; i += 8) bt.erase(i);
+        });
+    for (thread& th : writers) th.join();
+    for (int i = 0; i < 4000; ++i)
+        assert(bt.search(i) == (i % 8 >= 4));
+
+    // churn merges away thousands of nodes, which are freed as it goes
+    ConcurrentBPlus<int> churn (2);
+    vector<thread> threads;
+    for (int w = 0; w < 4; ++w)
+        threads.emplace_back([&churn, w]() {
+            for (int round = 0; round < 20; ++round) {
+                for (int i = w; i < 2000; i += 4) churn.insert(i);
+                for (int i = w; i < 2000; i += 4) {
+                    assert(churn.search(i) == true);
+                    churn.erase(i);
+                }
+            }
+        });
+    for (thread& th : threads) th.join();
+    assert(churn.search(7) == false);
+
+    // with no other call running, the next reclaim frees all but a handful
+    for (int round = 0; round < 5; ++round) {
+        for (int i = 0; i < 2000; ++i) churn.insert(i);
+        for (int i = 0; i < 2000; ++i) churn.erase(i);
+    }
+    assert(churn.retired_nodes() < 128);
+}
+
+// SnapshotBPlus
+void test_snapshot() {
+    SnapshotBPlus<int> bt (2);
+    for (int i = 0; i < 50; ++i) bt.insert(i);
+    auto before = bt.snapshot();
+    for (int i = 0; i < 50; i += 2) bt.erase(i);
+    bt.insert(100);
+
+    assert(before.search(0) == true);
+    assert(before.search(100) == false);
+    assert(bt.search(0) == false);
+    assert(bt.search(1) == true);
+    assert(bt.search(100) == true);
+
+    int count = 0;
+    before.traverse([&count](int k)->void{ assert(k == count); count += 1; });
+    assert(count == 50);
+}
+
+// PackedBPlus
+void test_packed() {
+    PackedBPlus<int64_t> bt (4);
+    for (int64_t i = 0; i < 300; ++i) bt.insert(1000000000000 + i * 3);
+    bt.insert(-5);
+    bt.insert(1LL << 40);
+    bt.erase(1000000000000 + 30);
+
+    assert(bt.search(1000000000000) == true);
+    assert(bt.search(1000000000000 + 30) == false);
+    assert(bt.search(1000000000000 + 31) == false);
+    assert(bt.search(-5) == true);
+    assert(bt.search(1LL << 40) == true);
+
+    int64_t last = -6;
+    int count = 0;
+    bt.traverse([&](int64_t k)->void{ assert(last < k); last = k; count += 1; });
+    assert(count == 301);
+}
+
+// BETree
+void test_betree() {
+    BETree bt (2, 8); // small buffers, so messages flush down every few calls
+    set<int> expected;
+    auto check = [&]() {
+        stringstream out;
+        streambuf* old = cout.rdbuf(out.rdbuf());
+        bt.traverse();
+        cout.rdbuf(old);
+        string keys;
+        for (int k : expected) keys += " " + to_string(k);
+        assert(out.str() == keys);
+        for (int k = -1; k <= 1001; ++k) assert(bt.search(k) == (expected.count(k) == 1));
+    };
+
+    for (int i = 0; i < 20000; ++i) {
+        int k = (int)((unsigned)i * 2654435761u % 1000);
+        if (i % 3 == 2) { // removes, of keys there and keys not
+            bt.remove(k);
+            expected.erase(k);
+        }
+        else {
+            bt.insert(k);
+            expected.insert(k);
+        }
+        if (i % 2500 == 0) check();
+    }
+    check();
+    for (int k = 0; k < 1000; k += 2) { // messages for keys still buffered above
+        bt.remove(k);
+        expected.erase(k);
+    }
+    check();
+}
+
+// Trace
+void test_trace() {
+    stringstream log;
+    BTree<int> bt (3);
+    int hits = 0;
+    {
+        Traced<BTree<int>, int> traced (bt, log);
+        for (int i = 0; i < 1000; ++i) traced.insert(i * 7 % 1000);
+        for (int i = 0; i < 1000; i += 2) traced.erase(i);
+        for (int i = 0; i < 1000; ++i) hits += traced.search(i);
+        traced.traverse([](int)->void{});
+    }
+    assert(hits == 500);
+
+    BPlus<int> bp (4); // the same calls against another layout
+    ReplayReport report = replay<BPlus<int>, int>(log, bp);
+    assert(report.ops[(int)TraceOp::insert] == 1000);
+    assert(report.ops[(int)TraceOp::erase] == 500);
+    assert(report.ops[(int)TraceOp::traverse] == 1);
+    assert(report.hits == 500);
+    assert(report.visited == 500);
+    assert(report.latency[(int)TraceOp::search].count == 1000);
+    assert(report.latency[(int)TraceOp::search].percentile(0.5) <= report.latency[(int)TraceOp::search].max);
+    assert(bp.search(1) && !bp.search(2));
+
+    stringstream words;
+    Trie trie;
+    {
+        Traced<Trie, string> traced (trie, words);
+        traced.insert("tree");
+        traced.insert("trie");
+        traced.erase("tree");
+        traced.search("trie");
+        traced.traverse([](const string&)->void{});
+    }
+    string bytes = words.str();
+    istringstream in (bytes);
+    Trie copy;
+    report = replay<Trie, string>(in, copy, false);
+    assert(report.hits == 1 && report.visited == 1);
+    assert(copy.search("trie") && !copy.search("tree"));
+
+    istringstream cut (bytes.substr(0, bytes.size() - 3)); // inside the search for "trie"
+    bool threw = false;
+    try { replay<Trie, string>(cut, copy); }
+    catch (const runtime_error&) { threw = true; }
+    assert(threw);
+
+    stringstream naturals; // the same size as int, ordered otherwise
+    BTree<unsigned> un (3);
+    {
+        Traced<BTree<unsigned>, unsigned> traced (un, naturals);
+        traced.insert(1u << 31);
+    }
+    assert(trace_key_type(naturals) == TreeFile::key_type<unsigned>());
+    naturals.seekg(0);
+    threw = false;
+    try { replay<BPlus<int>, int>(naturals, bp); }
+    catch (const runtime_error&) { threw = true; }
+    assert(threw);
+}
+
+// BurstTrie
+void test_burst_trie() {
+    BurstTrie bt (4); // tiny buckets, so words burst into nodes
+    vector<string> words = {"a", "ab", "abc", "abd", "abe", "abf", "b", "ba", "bat", "bath", "batch", "car", "cart", "\xff"};
+    for (const string& w : words) bt.insert(w);
+    bt.insert("abc");
+    bt.erase("ab");
+    bt.erase("bath");
+    bt.erase("zzz");
+
+    assert(bt.search("ab") == false);
+    assert(bt.search("abc") == true);
+    assert(bt.search("bath") == false);
+    assert(bt.search("batch") == true);
+    assert(bt.search("\xff") == true);
+    assert(bt.search("ca") == false);
+    assert(bt.search("") == false);
+
+    vector<string> seen;
+    bt.traverse([&seen](const string& s)->void{ seen.push_back(s); });
+    assert(seen.size() == words.size() - 2);
+    for (size_t i = 1; i < seen.size(); ++i) assert(seen[i - 1] < seen[i]);
+}
+
 int main() {
-//    test_insert_search();
-//    test_erase();
+    test_insert_search();
+    test_erase();
+    test_intern();
+    test_ingest();
+    test_longest_prefix_match();
+    test_minimize();
     test();
+    test_strings();
+    test_insert_batch();
+    test_erase_range();
+    test_set_operations();
+    test_build();
+    test_load();
+    test_save_restore();
+    test_learn();
+    test_stats();
+    test_parallel();
+    test_freeze();
+    test_compact();
+    test_allocators();
+    test_concurrent();
+    test_snapshot();
+    test_packed();
+    test_betree();
+    test_burst_trie();
+    test_trace();
     return 0;
 }
@@ -0,0 +1,121 @@
+// Replays a trace recorded with Traced (see Trace.h) against every structure
+// that takes its keys and prints one JSON object per structure, so layouts
+// can be compared on the same recorded traffic.
+//
+//   g++ -O2 -std=c++17 -pthread replay.cpp -o replay
+//   ./replay --trace calls.trace --t 32 --only BPlus
+//
+// Options: --trace FILE, --t T (minimum degree of the trees), --only NAME
+// (replay against a single structure), --latency 0 (time the replay as a
+// whole only, leaving the clock out of seconds and the counters).
+//
+// Latencies are per call type, in ns, and include the clock's overhead
+// (~20 ns). Hardware counters cover running the calls only; they are null
+// where perf_event_open is not allowed (see /proc/sys/kernel/perf_event_paranoid).
+#include <iostream>
+#include <fstream>
+#include <memory>
+#include <string>
+#include "Trace.h"
+#include "Trie.h"
+#include "BTree.h"
+#include "BPlus.h"
+#include "Pool.h"
+using namespace std;
+
+struct Config {
+    string trace;
+    string only;
+    int t = 16;
+    bool latency = true;
+};
+
+template<typename S, typename K, typename Make>
+void run(const Config& cfg, const string& name, Make make, bool& first) {
+    if (!cfg.only.empty() && cfg.only != name) return;
+    ifstream in (cfg.trace, ios::binary);
+    unique_ptr<S> s = make();
+    ReplayReport r = replay<S, K>(in, *s, cfg.latency);
+
+    uint64_t ops = 0;
+    for (uint64_t n : r.ops) ops += n;
+    cout << (first ? "" : ",\n") << "  {"
+         << "\"structure\": \"" << name << "\", "
+         << "\"t\": " << cfg.t << ", "
+         << "\"ops\": " << ops << ", "
+         << "\"seconds\": " << r.seconds << ", "
+         << "\"ops_per_sec\": " << (r.seconds > 0 ? (double)ops / r.seconds : 0) << ", "
+         << "\"hits\": " << r.hits << ", "
+         << "\"visited\": " << r.visited;
+    for (int i = 0; i < 4; ++i) {
+        const Histogram& h = r.latency[i];
+        cout << ", \"" << trace_op_names[i] << "\": {\"count\": " << r.ops[i];
+        if (cfg.latency)
+            cout << ", \"mean_ns\": " << h.mean()
+                 << ", \"p50_ns\": " << h.percentile(0.50)
+                 << ", \"p99_ns\": " << h.percentile(0.99)
+                 << ", \"p999_ns\": " << h.percentile(0.999)
+                 << ", \"max_ns\": " << h.max;
+        cout << "}";
+    }
+    for (int i = 0; i < PerfCounters::n; ++i) {
+        cout << ", \"" << PerfCounters::names[i] << "\": ";
+        if (r.counted[i]) cout << r.counter[i];
+        else cout << "null";
+    }
+    cout << "}";
+    first = false;
+    cout.flush();
+}
+
+template<typename K>
+void run_trees(const Config& cfg, bool& first) {
+    int t = cfg.t;
+    run<BTree<K>, K>(cfg, "BTree", [t] { return make_unique<BTree<K>>(t); }, first);
+    run<BPlus<K>, K>(cfg, "BPlus", [t] { return make_unique<BPlus<K>>(t); }, first);
+    run<BPlus<K, NoStats, PoolAllocator<K>>, K>(cfg, "BPlus+pool", [t] { return make_unique<BPlus<K, NoStats, PoolAllocator<K>>>(t); }, first);
+}
+
+int main(int argc, char** argv) {
+    Config cfg;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string opt = argv[i], val = argv[i + 1];
+        if (opt == "--trace") cfg.trace = val;
+        else if (opt == "--only") cfg.only = val;
+        else if (opt == "--t") cfg.t = stoi(val);
+        else if (opt == "--latency") cfg.latency = (val != "0");
+        else {
+            cerr << "unknown option " << opt << '\n';
+            return 1;
+        }
+    }
+    if (cfg.trace.empty()) {
+        cerr << "usage: replay --trace FILE [--t T] [--only NAME] [--latency 0|1]\n";
+        return 1;
+    }
+
+    try {
+        ifstream in (cfg.trace, ios::binary);
+        if (!in) throw runtime_error("cannot open " + cfg.trace);
+        // keys are replayed as the type they were recorded with, never as
+        // another of the same size, which would order their bits otherwise
+        uint32_t type = trace_key_type(in);
+        if (type != TreeFile::key_type<string>() && type != TreeFile::key_type<int>() && type != TreeFile::key_type<long long>())
+            throw runtime_error("no structure takes " + string((type >> 16) <= TreeFile::other_key ? TreeFile::kind_names[type >> 16] : "unknown")
+                                + " keys of " + to_string(type & 0xFFFF) + " bytes");
+        bool first = true;
+        cout << "[\n";
+        if (type == TreeFile::key_type<string>()) {
+            run<Trie, string>(cfg, "Trie", [] { return make_unique<Trie>(); }, first);
+            run_trees<string>(cfg, first);
+        }
+        else if (type == TreeFile::key_type<int>()) run_trees<int>(cfg, first);
+        else run_trees<long long>(cfg, first);
+        cout << "\n]\n";
+    }
+    catch (const exception& e) {
+        cerr << e.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,65 @@
+// Tests of bplustree.h, apart from main.cpp because its BTree clashes with
+// the one in BTree.h.
+//
+//   g++ -std=c++17 -Wall -g -fsanitize=address,undefined test_bplustree.cpp -o test_bplustree
+//   ASAN_OPTIONS=detect_leaks=0 ./test_bplustree
+//
+// Its BTree has no destructor, so the trees are leaked.
+#include <cassert>
+#include <sstream>
+#include <string>
+#include "bplustree.h"
+using namespace std;
+
+// what traverse prints, " k" per key
+string traversal(BTree& tree) {
+    stringstream out;
+    streambuf* old = cout.rdbuf(out.rdbuf());
+    tree.traverse();
+    cout.rdbuf(old);
+    return out.str();
+}
+
+string expected(int first, int last) {
+    string s;
+    for (int k = first; k <= last; ++k) s += " " + to_string(k);
+    return s;
+}
+
+void test_finger_ascending() {
+    // every key lands on the finger, which splits up through the parent
+    // links, the root among them, several times over
+    for (int t : {2, 3, 8}) {
+        BTree tree(t);
+        const int n = 20000;
+        for (int k = 1; k <= n; ++k) {
+            tree.insert(k);
+            if (k % 997 == 0) assert(tree.valid());
+        }
+        assert(tree.valid());
+        assert(traversal(tree) == expected(1, n));
+        for (int k = 1; k <= n; ++k) assert(tree.search(k) != NULL);
+        assert(tree.search(0) == NULL);
+        assert(tree.search(n + 1) == NULL);
+    }
+}
+
+void test_finger_moves() {
+    BTree tree(2);
+    // descending keys miss the finger each time and move it
+    for (int k = 3000; k >= 2001; --k) tree.insert(2 * k);
+    assert(tree.valid());
+    // ascending runs between the keys there, each starting off the finger
+    // and appending at it after
+    for (int k = 4001; k <= 5999; k += 2) tree.insert(k);
+    // and appending past the largest key
+    for (int k = 6001; k <= 9000; ++k) tree.insert(k);
+    assert(tree.valid());
+    assert(traversal(tree) == expected(4001, 9000));
+}
+
+int main() {
+    test_finger_ascending();
+    test_finger_moves();
+    return 0;
+}